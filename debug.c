@@ -531,11 +531,13 @@ static int rtw_debugfs_get_tx_pwr_tbl(struct seq_file *m, void *v)
 	u8 ch = hal->current_channel;
 	u8 regd = rtwdev->regd.txpwr_regd;
 
+	mutex_lock(&hal->tx_power_mutex);
+	seq_printf(m, "cache hit: %u, miss: %u, flush: %u\n",
+		   hal->tx_pwr_cache.hit_cnt, hal->tx_pwr_cache.miss_cnt,
+		   hal->tx_pwr_cache.flush_cnt);
 	seq_printf(m, "%-4s %-10s %-3s%6s %-4s %4s (%-4s %-4s %-4s) %-4s\n",
 		   "path", "rate", "pwr", "", "base", "", "byr", "lmt", "sar",
 		   "rem");
-
-	mutex_lock(&hal->tx_power_mutex);
 	for (path = RF_PATH_A; path <= RF_PATH_B; path++) {
 		/* there is no CCK rates used in 5G */
 		if (hal->current_band_type == RTW_BAND_5G)
@@ -708,6 +710,518 @@ static int rtw_debugfs_get_sar(struct seq_file *m, void *v)
 	return 0;
 }
 
+static int rtw_debugfs_get_h2c_stats(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	u32 sent_cnt, coalesce_cnt, drop_cnt, latency_max, pending;
+	u64 latency_sum;
+
+	spin_lock(&rtwdev->h2c.lock);
+	pending = rtwdev->h2c.queue_len;
+	sent_cnt = rtwdev->h2c.sent_cnt;
+	coalesce_cnt = rtwdev->h2c.coalesce_cnt;
+	drop_cnt = rtwdev->h2c.drop_cnt;
+	latency_max = rtwdev->h2c.latency_max_us;
+	latency_sum = rtwdev->h2c.latency_sum_us;
+	spin_unlock(&rtwdev->h2c.lock);
+
+	seq_printf(m, "pending: %u\n", pending);
+	seq_printf(m, "sent: %u\n", sent_cnt);
+	seq_printf(m, "coalesced: %u\n", coalesce_cnt);
+	seq_printf(m, "dropped: %u\n", drop_cnt);
+	seq_printf(m, "latency avg/max (us): %llu/%u\n",
+		   sent_cnt ? div_u64(latency_sum, sent_cnt) : 0, latency_max);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_c2h_stats(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_c2h_stat *stat;
+	int id;
+
+	seq_puts(m, "id   count      avg(us)    max(us)\n");
+	for (id = 0; id <= U8_MAX; id++) {
+		stat = &rtwdev->c2h_stats[id];
+		if (!stat->cnt)
+			continue;
+
+		seq_printf(m, "0x%02x %-10u %-10llu %u\n", id, stat->cnt,
+			   div_u64(stat->latency_sum_us, stat->cnt),
+			   stat->latency_max_us);
+	}
+
+	return 0;
+}
+
+static void rtw_debugfs_fw_dl_print(struct seq_file *m, const char *name,
+				    struct rtw_fw_state *fw)
+{
+	if (!fw->firmware)
+		return;
+
+	seq_printf(m, "%s: download count %u, last download %u us\n",
+		   name, fw->dl_cnt, fw->dl_time_us);
+	seq_printf(m, "\ttxbuf %u us, ddma wait %u us, validate %u us\n",
+		   fw->dl_txbuf_us, fw->dl_ddma_us, fw->dl_validate_us);
+}
+
+static int rtw_debugfs_get_fw_dl(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+
+	mutex_lock(&rtwdev->mutex);
+	rtw_debugfs_fw_dl_print(m, "normal", &rtwdev->fw);
+	rtw_debugfs_fw_dl_print(m, "wow", &rtwdev->wow_fw);
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static void rtw_debugfs_pwr_prog_print(struct seq_file *m, const char *name,
+				       struct rtw_pwr_prog *prog)
+{
+	seq_printf(m, "%s: %u cmds, count %u, last %u us, max %u us, avg %llu us\n",
+		   name, prog->num, prog->cnt, prog->last_us, prog->max_us,
+		   prog->cnt ? div_u64(prog->total_us, prog->cnt) : 0);
+}
+
+static int rtw_debugfs_get_pwr_seq(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+
+	mutex_lock(&rtwdev->mutex);
+	rtw_debugfs_pwr_prog_print(m, "power on", &rtwdev->pwr_on_prog);
+	rtw_debugfs_pwr_prog_print(m, "power off", &rtwdev->pwr_off_prog);
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_pwrtrack(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_pwrtrack_info *pt = &rtwdev->dm_info.pwrtrack;
+	struct rtw_pwrtrack_trace *trace;
+	u8 path_num = rtwdev->hal.rf_path_num;
+	u32 num;
+	int i;
+	u8 apply;
+	u8 path;
+
+	mutex_lock(&rtwdev->mutex);
+	seq_printf(m, "sample: %u, skip: %u, interval: %u, stable: %u\n",
+		   pt->sample_cnt, pt->skip_cnt, pt->interval, pt->stable_cnt);
+	seq_printf(m, "applied: %u, valid: %d\n", pt->trace_cnt, pt->valid);
+
+	num = min_t(u32, pt->trace_cnt, RTW_PWRTRACK_TRACE_NUM);
+	for (i = num; i > 0; i--) {
+		trace = &pt->trace[(pt->trace_head + RTW_PWRTRACK_TRACE_NUM - i) %
+				   RTW_PWRTRACK_TRACE_NUM];
+		apply = trace->apply;
+		seq_printf(m, "%10u ms%s%s%s%s%s", trace->time_ms,
+			   apply & RTW_PWRTRACK_APPLY_OFDM ? " ofdm" : "",
+			   apply & RTW_PWRTRACK_APPLY_CCK ? " cck" : "",
+			   apply & RTW_PWRTRACK_APPLY_TXAGC ? " txagc" : "",
+			   apply & RTW_PWRTRACK_APPLY_XTAL ? " xtal" : "",
+			   apply & RTW_PWRTRACK_APPLY_IQK ? " iqk" : "");
+		for (path = 0; path < path_num; path++)
+			seq_printf(m, ", %c: thermal %u pwr idx %d",
+				   'A' + path, trace->thermal[path],
+				   trace->pwr_idx[path]);
+		seq_puts(m, "\n");
+	}
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_chsw_stats(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_chsw_stats *stats = &rtwdev->hal.chsw_stats;
+	static const char * const stage_str[] = {
+		[RTW_CHSW_RF] = "rf",
+		[RTW_CHSW_SPUR] = "spur",
+		[RTW_CHSW_MAC] = "mac",
+		[RTW_CHSW_BB] = "bb",
+		[RTW_CHSW_CHIP] = "chip",
+		[RTW_CHSW_COEX] = "coex",
+		[RTW_CHSW_TXPWR] = "txpwr",
+		[RTW_CHSW_TOTAL] = "total",
+	};
+	int i, j;
+
+	mutex_lock(&rtwdev->mutex);
+	seq_printf(m, "switch: %u, bw unchanged: %u\n",
+		   stats->cnt[RTW_CHSW_TOTAL], stats->fast_cnt);
+	for (i = 0; i < RTW_CHSW_STAGE_NUM; i++)
+		seq_printf(m, "%-6s cnt %u, max %u us, avg %llu us\n",
+			   stage_str[i], stats->cnt[i], stats->max_us[i],
+			   stats->cnt[i] ?
+			   div_u64(stats->total_us[i], stats->cnt[i]) : 0);
+
+	seq_printf(m, "%-8s", "< us");
+	for (i = 0; i < RTW_CHSW_STAGE_NUM; i++)
+		seq_printf(m, " %7s", stage_str[i]);
+	seq_puts(m, "\n");
+	for (j = 0; j < RTW_CHSW_HIST_NUM; j++) {
+		if (j < RTW_CHSW_HIST_NUM - 1)
+			seq_printf(m, "%-8lu", BIT(j));
+		else
+			seq_printf(m, "%-8s", "longer");
+		for (i = 0; i < RTW_CHSW_STAGE_NUM; i++)
+			seq_printf(m, " %7u", stats->hist[i][j]);
+		seq_puts(m, "\n");
+	}
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_cali_cache(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_cali_cache *cache = &rtwdev->dm_info.cali_cache;
+	struct rtw_cali_cache_entry *entry;
+	unsigned long flags;
+	u32 hit, miss;
+	int i;
+
+	spin_lock_irqsave(&rtwdev->dm_lock, flags);
+	hit = cache->hit_cnt;
+	miss = cache->miss_cnt;
+	seq_printf(m, "hit: %u, miss: %u, hit rate: %u%%\n", hit, miss,
+		   hit + miss ? hit * 100 / (hit + miss) : 0);
+	seq_printf(m, "calibration time: %llu us, saved: %llu us\n",
+		   cache->cali_us, cache->saved_us);
+
+	for (i = 0; i < RTW_CALI_CACHE_NUM; i++) {
+		entry = &cache->entry[i];
+		if (!entry->valid)
+			continue;
+		seq_printf(m, "[%2d] band %u group %u bw %u thermal %u, %u us\n",
+			   i, entry->band, entry->ch_group, entry->bw,
+			   entry->thermal, entry->cali_us);
+	}
+	spin_unlock_irqrestore(&rtwdev->dm_lock, flags);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_dm_engine(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_dm_engine *engine = &rtwdev->dm_engine;
+
+	mutex_lock(&rtwdev->dm_mutex);
+	seq_printf(m, "enabled: %d, period: %u ms (param %u ms)\n",
+		   engine->enabled, engine->period_ms, rtw_dm_period_ms);
+	seq_printf(m, "run: %u, skip: %u, igi: 0x%02x\n",
+		   engine->run_cnt, engine->skip_cnt,
+		   rtwdev->dm_info.igi_history[0]);
+	seq_printf(m, "igi converged: %u, last %u ms, max %u ms, avg %llu ms%s\n",
+		   engine->conv_cnt, engine->conv_last_ms, engine->conv_max_ms,
+		   engine->conv_cnt ?
+		   div_u64(engine->conv_total_ms, engine->conv_cnt) : 0,
+		   engine->converging ? " (converging)" : "");
+	mutex_unlock(&rtwdev->dm_mutex);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_txagc(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_hal *hal = &rtwdev->hal;
+	struct rtw_txagc_writer *txagc = &hal->txagc;
+
+	mutex_lock(&hal->tx_power_mutex);
+	seq_printf(m, "set_tx_power_index: %u, avg mmio %llu\n",
+		   txagc->set_cnt, txagc->set_cnt ?
+		   div_u64(txagc->total_mmio, txagc->set_cnt) : 0);
+	seq_printf(m, "last: %u reads, %u writes, %u regs skipped\n",
+		   txagc->read_cnt, txagc->write_cnt, txagc->skip_cnt);
+	mutex_unlock(&hal->tx_power_mutex);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_rf_shadow(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_rf_shadow *shadow = &rtwdev->rf_shadow;
+	unsigned long flags;
+	u32 valid[RTW_RF_PATH_MAX];
+	u32 hit, miss, rmw_hit, rmw_miss;
+	u8 path;
+
+	if (!rtwdev->chip->rf_volatile_regs) {
+		seq_puts(m, "rf shadow not supported\n");
+		return 0;
+	}
+
+	spin_lock_irqsave(&rtwdev->rf_lock, flags);
+	for (path = 0; path < RTW_RF_PATH_MAX; path++)
+		valid[path] = bitmap_weight(shadow->valid[path],
+					    RTW_RF_SHADOW_SIZE);
+	hit = shadow->hit_cnt;
+	miss = shadow->miss_cnt;
+	rmw_hit = shadow->rmw_hit_cnt;
+	rmw_miss = shadow->rmw_miss_cnt;
+	spin_unlock_irqrestore(&rtwdev->rf_lock, flags);
+
+	seq_printf(m, "read hit: %u, miss: %u\n", hit, miss);
+	seq_printf(m, "masked write hit: %u, miss: %u\n", rmw_hit, rmw_miss);
+	for (path = 0; path < rtwdev->hal.rf_path_num; path++)
+		seq_printf(m, "path %c cached: %u\n", 'A' + path, valid[path]);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_phy_tbl(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_phy_tbl_cache *cache = &rtwdev->phy_tbl;
+	static const char * const load_str[] = {"parsed", "precompiled"};
+	struct rtw_phy_tbl_load_stat *stat;
+	u32 cmd_num = 0;
+	int i;
+
+	mutex_lock(&rtwdev->mutex);
+	for (i = 0; i < cache->prog_num; i++)
+		cmd_num += cache->prog[i].num;
+
+	seq_printf(m, "precompile: %d, tables: %u, entries: %u/%u, compile: %u us\n",
+		   rtw_phy_tbl_precompile, cache->prog_num, cmd_num,
+		   cache->tile_num, cache->compile_us);
+	for (i = 0; i < ARRAY_SIZE(cache->load); i++) {
+		stat = &cache->load[i];
+		seq_printf(m, "%-12s load: %u, last %u us, max %u us, avg %llu us\n",
+			   load_str[i], stat->cnt, stat->last_us, stat->max_us,
+			   stat->cnt ? div_u64(stat->total_us, stat->cnt) : 0);
+	}
+	seq_printf(m, "last precompiled load: %u reg writes in %u batches, %u rf writes\n",
+		   cache->reg_write_cnt, cache->batch_cnt, cache->rf_write_cnt);
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_ips_stats(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_ips *ips = &rtwdev->ips;
+	static const char * const mode_str[] = {
+		[RTW_IPS_MODE_PWR_OFF] = "pwr_off",
+		[RTW_IPS_MODE_BB_OFF] = "bb_off",
+	};
+	int i;
+
+	mutex_lock(&rtwdev->mutex);
+	seq_printf(m, "mode: %u, bb off: %d\n", rtw_ips_mode, ips->bb_off);
+	for (i = 0; i < RTW_IPS_MODE_NUM; i++)
+		seq_printf(m, "%-8s enter: %u, leave: %u, last %u us, max %u us, avg %llu us\n",
+			   mode_str[i], ips->enter_cnt[i], ips->leave_cnt[i],
+			   ips->leave_last_us[i], ips->leave_max_us[i],
+			   ips->leave_cnt[i] ?
+			   div_u64(ips->leave_total_us[i], ips->leave_cnt[i]) : 0);
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_deep_ps_stats(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_deep_ps_stats *stats = &rtwdev->deep_ps_stats;
+	int i;
+
+	seq_printf(m, "leave by irq: %u, by poll: %u, retry: %u, fail: %u\n",
+		   stats->irq_cnt, stats->poll_cnt, stats->retry_cnt,
+		   stats->fail_cnt);
+	seq_printf(m, "max: %u us\n", stats->max_us);
+	seq_printf(m, "%-10s %10s %10s\n", "< us", "LCLK", "PG");
+	for (i = 0; i < RTW_DEEP_PS_HIST_NUM - 1; i++)
+		seq_printf(m, "%-10lu %10u %10u\n", BIT(i),
+			   stats->hist[LPS_DEEP_MODE_LCLK][i],
+			   stats->hist[LPS_DEEP_MODE_PG][i]);
+	seq_printf(m, "%-10s %10u %10u\n", "longer",
+		   stats->hist[LPS_DEEP_MODE_LCLK][i],
+		   stats->hist[LPS_DEEP_MODE_PG][i]);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_lps_stats(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_lps_ctrl *ctrl = &rtwdev->lps_ctrl;
+	u64 residency_us;
+
+	mutex_lock(&rtwdev->mutex);
+	residency_us = ctrl->residency_us;
+	if (test_bit(RTW_FLAG_LEISURE_PS, rtwdev->flags))
+		residency_us += ktime_us_delta(ktime_get(), ctrl->enter_time);
+
+	seq_printf(m, "in lps: %d, idle gap: %u ms\n",
+		   test_bit(RTW_FLAG_LEISURE_PS, rtwdev->flags),
+		   rtw_lps_idle_gap_ms);
+	seq_printf(m, "residency: %llu ms\n", div_u64(residency_us, 1000));
+	seq_printf(m, "enter: %u (idle %u), last %u us, max %u us, avg %llu us\n",
+		   ctrl->enter_cnt, ctrl->idle_enter_cnt, ctrl->enter_last_us,
+		   ctrl->enter_max_us, ctrl->enter_cnt ?
+		   div_u64(ctrl->enter_total_us, ctrl->enter_cnt) : 0);
+	seq_printf(m, "leave: %u (predict %u), last %u us, max %u us, avg %llu us\n",
+		   ctrl->leave_cnt, ctrl->predict_leave_cnt,
+		   ctrl->leave_last_us, ctrl->leave_max_us, ctrl->leave_cnt ?
+		   div_u64(ctrl->leave_total_us, ctrl->leave_cnt) : 0);
+	seq_printf(m, "traffic: BE %u, BK %u, VI %u, VO %u\n",
+		   ctrl->ac_cnt[IEEE80211_AC_BE], ctrl->ac_cnt[IEEE80211_AC_BK],
+		   ctrl->ac_cnt[IEEE80211_AC_VI], ctrl->ac_cnt[IEEE80211_AC_VO]);
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_flush_stats(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_flush_stats *stats = &rtwdev->flush_stats;
+
+	mutex_lock(&rtwdev->mutex);
+	seq_printf(m, "flush: %u, drop: %u, timeout: %u\n",
+		   stats->cnt, stats->drop_cnt, stats->timeout_cnt);
+	seq_printf(m, "duration: last %u us, max %u us, avg %llu us\n",
+		   stats->last_us, stats->max_us,
+		   stats->cnt ? div_u64(stats->total_us, stats->cnt) : 0);
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_efuse_map(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_efuse *efuse = &rtwdev->efuse;
+
+	if (!efuse->log_map)
+		return 0;
+
+	seq_printf(m, "physical bytes read: %u/%u\n", efuse->phy_read_size,
+		   efuse->physical_size);
+	seq_hex_dump(m, "", DUMP_PREFIX_OFFSET, 16, 1, efuse->log_map,
+		     efuse->logical_size, false);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_poll_stats(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_poll_stats *stats = &rtwdev->poll_stats;
+	struct rtw_poll_stat *stat;
+	unsigned long flags;
+	int i;
+
+	seq_printf(m, "%-48s %8s %8s %10s %10s\n",
+		   "caller", "count", "timeout", "max(us)", "total(us)");
+
+	spin_lock_irqsave(&stats->lock, flags);
+	for (i = 0; i < RTW_POLL_STAT_NUM; i++) {
+		stat = &stats->stat[i];
+		if (!stat->ip)
+			break;
+
+		seq_printf(m, "%-48pS %8u %8u %10u %10llu\n",
+			   (void *)stat->ip, stat->cnt, stat->timeout_cnt,
+			   stat->max_us, stat->total_us);
+	}
+	seq_printf(m, "untracked callers: %u\n", stats->overflow_cnt);
+	spin_unlock_irqrestore(&stats->lock, flags);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_boot_time(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_boot_time *boot_time = &rtwdev->boot_time;
+
+	seq_puts(m, "time since probe (us)\n");
+	seq_printf(m, "firmware loaded: %u\n", boot_time->fw_loaded);
+	seq_printf(m, "chip setup: %u\n", boot_time->chip_setup);
+	seq_printf(m, "first start: %u\n", boot_time->first_start);
+	seq_printf(m, "first link: %u\n", boot_time->first_link);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_rsvd_page_dl(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+	struct rtw_rsvd_page_cache *cache = &rtwdev->rsvd_page_cache;
+
+	mutex_lock(&rtwdev->mutex);
+	seq_printf(m, "last download bytes: %u\n", cache->last_dl_bytes);
+	seq_printf(m, "download count: %u\n", cache->dl_cnt);
+	seq_printf(m, "total download bytes: %llu\n", cache->total_dl_bytes);
+	seq_printf(m, "cached pages: %u%s\n", cache->page_num,
+		   cache->valid ? "" : " (invalid)");
+	mutex_unlock(&rtwdev->mutex);
+
+	return 0;
+}
+
+static int rtw_debugfs_get_rx_hist(struct seq_file *m, void *v)
+{
+	struct rtw_debugfs_priv *debugfs_priv = m->private;
+	struct rtw_dev *rtwdev = debugfs_priv->rtwdev;
+
+	/* counters are updated lockless in rx path, a torn sample is
+	 * acceptable for statistics
+	 */
+	seq_write(m, rtwdev->rx_hist, sizeof(*rtwdev->rx_hist));
+
+	return 0;
+}
+
+static ssize_t rtw_debugfs_set_rx_hist(struct file *filp,
+				       const char __user *buffer,
+				       size_t count, loff_t *loff)
+{
+	struct seq_file *seqpriv = (struct seq_file *)filp->private_data;
+	struct rtw_debugfs_priv *debugfs_priv = seqpriv->private;
+	struct rtw_rx_hist *hist = debugfs_priv->rtwdev->rx_hist;
+
+	/* any write clears the counters, the header is kept */
+	hist->drain_cnt = 0;
+	memset(hist->ring_occ, 0, sizeof(hist->ring_occ));
+	memset(hist->stat, 0, sizeof(hist->stat));
+
+	return count;
+}
+
 #define rtw_debug_impl_mac(page, addr)				\
 static struct rtw_debugfs_priv rtw_debug_priv_mac_ ##page = {	\
 	.cb_read = rtw_debug_get_mac_page,			\
@@ -802,6 +1316,87 @@ static struct rtw_debugfs_priv rtw_debug_priv_sar = {
 	.cb_read = rtw_debugfs_get_sar,
 };
 
+static struct rtw_debugfs_priv rtw_debug_priv_h2c_stats = {
+	.cb_read = rtw_debugfs_get_h2c_stats,
+};
+
+static struct rtw_debugfs_priv rtw_debug_priv_c2h_stats = {
+	.cb_read = rtw_debugfs_get_c2h_stats,
+};
+
+static struct rtw_debugfs_priv rtw_debug_priv_pwrtrack = {
+	.cb_read = rtw_debugfs_get_pwrtrack,
+};
+
+static struct rtw_debugfs_priv rtw_debug_priv_chsw_stats = {
+	.cb_read = rtw_debugfs_get_chsw_stats,
+};
+
+static struct rtw_debugfs_priv rtw_debug_priv_cali_cache = {
+	.cb_read = rtw_debugfs_get_cali_cache,
+};
+
+static struct rtw_debugfs_priv rtw_debug_priv_dm_engine = {
+	.cb_read = rtw_debugfs_get_dm_engine,
+};
+
+static struct rtw_debugfs_priv rtw_debug_priv_txagc = {
+	.cb_read = rtw_debugfs_get_txagc,
+};
+
+static struct rtw_debugfs_priv rtw_debug_priv_rf_shadow = {
+	.cb_read = rtw_debugfs_get_rf_shadow,
+};
+
+static struct rtw_debugfs_priv rtw_debug_priv_phy_tbl = {
+	.cb_read = rtw_debugfs_get_phy_tbl,
+};
+
+static struct rtw_debugfs_priv rtw_debug_priv_ips_stats = {
+	.cb_read = rtw_debugfs_get_ips_stats,
+};
+
+static struct rtw_debugfs_priv rtw_debug_priv_deep_ps_stats = {
+	.cb_read = rtw_debugfs_get_deep_ps_stats,
+};
+
+static struct rtw_debugfs_priv rtw_debug_priv_lps_stats = {
+	.cb_read = rtw_debugfs_get_lps_stats,
+};
+
+static struct rtw_debugfs_priv rtw_debug_priv_flush_stats = {
+	.cb_read = rtw_debugfs_get_flush_stats,
+};
+
+static struct rtw_debugfs_priv rtw_debug_priv_efuse_map = {
+	.cb_read = rtw_debugfs_get_efuse_map,
+};
+
+static struct rtw_debugfs_priv rtw_debug_priv_poll_stats = {
+	.cb_read = rtw_debugfs_get_poll_stats,
+};
+
+static struct rtw_debugfs_priv rtw_debug_priv_pwr_seq = {
+	.cb_read = rtw_debugfs_get_pwr_seq,
+};
+
+static struct rtw_debugfs_priv rtw_debug_priv_boot_time = {
+	.cb_read = rtw_debugfs_get_boot_time,
+};
+
+static struct rtw_debugfs_priv rtw_debug_priv_fw_dl = {
+	.cb_read = rtw_debugfs_get_fw_dl,
+};
+
+static struct rtw_debugfs_priv rtw_debug_priv_rsvd_page_dl = {
+	.cb_read = rtw_debugfs_get_rsvd_page_dl,
+};
+
+static struct rtw_debugfs_priv rtw_debug_priv_rx_hist = {
+	.cb_write = rtw_debugfs_set_rx_hist,
+	.cb_read = rtw_debugfs_get_rx_hist,
+};
+
 #define rtw_debugfs_add_core(name, mode, fopname, parent)		\
 	do {								\
 		rtw_debug_priv_ ##name.rtwdev = rtwdev;			\
@@ -833,6 +1428,26 @@ void rtw_debugfs_init(struct rtw_dev *rtwdev)
 	rtw_debugfs_add_rw(rsvd_page);
 	rtw_debugfs_add_r(phy_info);
 	rtw_debugfs_add_r(sar);
+	rtw_debugfs_add_rw(rx_hist);
+	rtw_debugfs_add_r(h2c_stats);
+	rtw_debugfs_add_r(c2h_stats);
+	rtw_debugfs_add_r(rsvd_page_dl);
+	rtw_debugfs_add_r(fw_dl);
+	rtw_debugfs_add_r(boot_time);
+	rtw_debugfs_add_r(pwr_seq);
+	rtw_debugfs_add_r(poll_stats);
+	rtw_debugfs_add_r(efuse_map);
+	rtw_debugfs_add_r(flush_stats);
+	rtw_debugfs_add_r(lps_stats);
+	rtw_debugfs_add_r(deep_ps_stats);
+	rtw_debugfs_add_r(ips_stats);
+	rtw_debugfs_add_r(phy_tbl);
+	rtw_debugfs_add_r(rf_shadow);
+	rtw_debugfs_add_r(txagc);
+	rtw_debugfs_add_r(dm_engine);
+	rtw_debugfs_add_r(cali_cache);
+	rtw_debugfs_add_r(chsw_stats);
+	rtw_debugfs_add_r(pwrtrack);
 	rtw_debugfs_add_r(mac_0);
 	rtw_debugfs_add_r(mac_1);
 	rtw_debugfs_add_r(mac_2);
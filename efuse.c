@@ -26,6 +26,39 @@ static void switch_efuse_bank(struct rtw_dev *rtwdev)
 #define block_idx_to_logical_idx(blk_idx, i) \
 	(((blk_idx) << 3) + ((i) << 1))
 
+/* Read physical efuse bytes up to end, bytes before efuse->phy_read_size
+ * have been read already. Only the part used by the logical map is read.
+ */
+static int rtw_read_physical_efuse(struct rtw_dev *rtwdev, u8 *map, u32 end)
+{
+	struct rtw_efuse *efuse = &rtwdev->efuse;
+	u32 efuse_ctl;
+	u32 addr;
+
+	end = min(end, efuse->physical_size);
+	if (efuse->phy_read_size >= end)
+		return 0;
+
+	efuse_ctl = rtw_read32(rtwdev, REG_EFUSE_CTRL);
+
+	for (addr = efuse->phy_read_size; addr < end; addr++) {
+		efuse_ctl &= ~(BIT_MASK_EF_DATA | BITS_EF_ADDR);
+		efuse_ctl |= (addr & BIT_MASK_EF_ADDR) << BIT_SHIFT_EF_ADDR;
+		rtw_write32(rtwdev, REG_EFUSE_CTRL, efuse_ctl & (~BIT_EF_FLAG));
+
+		if (rtw_poll32_timeout(rtwdev, REG_EFUSE_CTRL, BIT_EF_FLAG,
+				       BIT_EF_FLAG, 1000000))
+			return -EBUSY;
+
+		efuse_ctl = rtw_read32(rtwdev, REG_EFUSE_CTRL);
+		*(map + addr) = (u8)(efuse_ctl & BIT_MASK_EF_DATA);
+	}
+
+	efuse->phy_read_size = end;
+
+	return 0;
+}
+
 /* efuse header format
  *
  * | 7        5   4    0 | 7        4   3          0 | 15  8  7   0 |
@@ -45,9 +78,14 @@ static int rtw_dump_logical_efuse_map(struct rtw_dev *rtwdev, u8 *phy_map,
 	u8 hdr1, hdr2;
 	u8 blk_idx;
 	u8 word_en;
+	int ret;
 	int i;
 
 	for (phy_idx = 0; phy_idx < physical_size - protect_size;) {
+		ret = rtw_read_physical_efuse(rtwdev, phy_map, phy_idx + 2);
+		if (ret)
+			return ret;
+
 		hdr1 = phy_map[phy_idx];
 		hdr2 = phy_map[phy_idx + 1];
 		if (invalid_efuse_header(hdr1, hdr2))
@@ -74,6 +112,11 @@ static int rtw_dump_logical_efuse_map(struct rtw_dev *rtwdev, u8 *phy_map,
 			    log_idx + 1 > logical_size)
 				return -EINVAL;
 
+			ret = rtw_read_physical_efuse(rtwdev, phy_map,
+						      phy_idx + 2);
+			if (ret)
+				return ret;
+
 			log_map[log_idx] = phy_map[phy_idx];
 			log_map[log_idx + 1] = phy_map[phy_idx + 1];
 			phy_idx += 2;
@@ -82,13 +125,11 @@ static int rtw_dump_logical_efuse_map(struct rtw_dev *rtwdev, u8 *phy_map,
 	return 0;
 }
 
-static int rtw_dump_physical_efuse_map(struct rtw_dev *rtwdev, u8 *map)
+static int rtw_dump_efuse_map(struct rtw_dev *rtwdev, u8 *phy_map,
+			      u8 *log_map)
 {
 	struct rtw_chip_info *chip = rtwdev->chip;
-	u32 size = rtwdev->efuse.physical_size;
-	u32 efuse_ctl;
-	u32 addr;
-	u32 cnt;
+	int ret;
 
 	rtw_efuse_en(rtwdev, true);
 
@@ -97,29 +138,19 @@ static int rtw_dump_physical_efuse_map(struct rtw_dev *rtwdev, u8 *map)
 	/* disable 2.5V LDO */
 	chip->ops->cfg_ldo25(rtwdev, false);
 
-	efuse_ctl = rtw_read32(rtwdev, REG_EFUSE_CTRL);
-
-	for (addr = 0; addr < size; addr++) {
-		efuse_ctl &= ~(BIT_MASK_EF_DATA | BITS_EF_ADDR);
-		efuse_ctl |= (addr & BIT_MASK_EF_ADDR) << BIT_SHIFT_EF_ADDR;
-		rtw_write32(rtwdev, REG_EFUSE_CTRL, efuse_ctl & (~BIT_EF_FLAG));
-
-		cnt = 1000000;
-		do {
-			udelay(1);
-			efuse_ctl = rtw_read32(rtwdev, REG_EFUSE_CTRL);
-			if (--cnt == 0)
-				return -EBUSY;
-		} while (!(efuse_ctl & BIT_EF_FLAG));
-
-		*(map + addr) = (u8)(efuse_ctl & BIT_MASK_EF_DATA);
-	}
+	rtwdev->efuse.phy_read_size = 0;
+	memset(phy_map, 0xff, rtwdev->efuse.physical_size);
+	memset(log_map, 0xff, rtwdev->efuse.logical_size);
+	ret = rtw_dump_logical_efuse_map(rtwdev, phy_map, log_map);
 
 	rtw_efuse_en(rtwdev, false);
 
-	return 0;
+	return ret;
 }
 
+/* The logical map is read from hardware once and kept for the lifetime
+ * of the device, later parses decode the cached map.
+ */
 int rtw_parse_efuse_map(struct rtw_dev *rtwdev)
 {
 	struct rtw_chip_info *chip = rtwdev->chip;
@@ -130,6 +161,9 @@ int rtw_parse_efuse_map(struct rtw_dev *rtwdev)
 	u8 *log_map = NULL;
 	int ret = 0;
 
+	if (efuse->log_map)
+		goto parse;
+
 	phy_map = kmalloc(phy_size, GFP_KERNEL);
 	log_map = kmalloc(log_size, GFP_KERNEL);
 	if (!phy_map || !log_map) {
@@ -137,24 +171,22 @@ int rtw_parse_efuse_map(struct rtw_dev *rtwdev)
 		goto out_free;
 	}
 
-	ret = rtw_dump_physical_efuse_map(rtwdev, phy_map);
-	if (ret) {
-		rtw_err(rtwdev, "failed to dump efuse physical map\n");
-		goto out_free;
-	}
-
-	memset(log_map, 0xff, log_size);
-	ret = rtw_dump_logical_efuse_map(rtwdev, phy_map, log_map);
+	ret = rtw_dump_efuse_map(rtwdev, phy_map, log_map);
 	if (ret) {
 		rtw_err(rtwdev, "failed to dump efuse logical map\n");
 		goto out_free;
 	}
 
-	ret = chip->ops->read_efuse(rtwdev, log_map);
-	if (ret) {
+	rtw_dbg(rtwdev, RTW_DBG_EFUSE, "read %u of %u physical efuse bytes\n",
+		efuse->phy_read_size, phy_size);
+
+	efuse->log_map = log_map;
+	log_map = NULL;
+
+parse:
+	ret = chip->ops->read_efuse(rtwdev, efuse->log_map);
+	if (ret)
 		rtw_err(rtwdev, "failed to read efuse map\n");
-		goto out_free;
-	}
 
 out_free:
 	kfree(log_map);
@@ -2,6 +2,7 @@
 /* Copyright(c) 2018-2019  Realtek Corporation
  */
 
+#include <linux/crc32.h>
 #include "main.h"
 #include "coex.h"
 #include "fw.h"
@@ -114,17 +115,40 @@ static void rtw_fw_ra_report_handle(struct rtw_dev *rtwdev, u8 *payload,
 				    u8 length)
 {
 	struct rtw_fw_iter_ra_data ra_data;
+	unsigned long flags;
 
 	if (WARN(length < 7, "invalid ra report c2h length\n"))
 		return;
 
+	/* ra report is updated in rx context, dm_lock protects it */
+	spin_lock_irqsave(&rtwdev->dm_lock, flags);
 	rtwdev->dm_info.tx_rate = GET_RA_REPORT_RATE(payload);
 	ra_data.rtwdev = rtwdev;
 	ra_data.payload = payload;
 	rtw_iterate_stas_atomic(rtwdev, rtw_fw_ra_report_iter, &ra_data);
+	spin_unlock_irqrestore(&rtwdev->dm_lock, flags);
 }
 
-void rtw_fw_c2h_cmd_handle(struct rtw_dev *rtwdev, struct sk_buff *skb)
+static void rtw_fw_c2h_stat_update(struct rtw_dev *rtwdev,
+				   struct sk_buff *skb, u8 id)
+{
+	struct rtw_c2h_stat *stat = &rtwdev->c2h_stats[id];
+	u32 latency;
+
+	/* tstamp is marked when the C2H is received */
+	latency = ktime_us_delta(ktime_get(), skb->tstamp);
+
+	stat->cnt++;
+	stat->latency_sum_us += latency;
+	if (latency > stat->latency_max_us)
+		stat->latency_max_us = latency;
+}
+
+/* C2H which does not need rtwdev->mutex and can be handled in rx context,
+ * the others are deferred to c2h_work.
+ */
+static bool rtw_fw_c2h_cmd_handle_atomic(struct rtw_dev *rtwdev,
+					 struct sk_buff *skb)
 {
 	struct rtw_c2h_cmd *c2h;
 	u32 pkt_offset;
@@ -134,12 +158,40 @@ void rtw_fw_c2h_cmd_handle(struct rtw_dev *rtwdev, struct sk_buff *skb)
 	c2h = (struct rtw_c2h_cmd *)(skb->data + pkt_offset);
 	len = skb->len - pkt_offset - 2;
 
-	mutex_lock(&rtwdev->mutex);
-
 	switch (c2h->id) {
 	case C2H_CCX_TX_RPT:
 		rtw_tx_report_handle(rtwdev, skb, C2H_CCX_TX_RPT);
 		break;
+	case C2H_RA_RPT:
+		rtw_fw_ra_report_handle(rtwdev, c2h->payload, len);
+		break;
+	case C2H_HALMAC:
+		if (c2h->payload[0] != C2H_CCX_RPT)
+			return false;
+		rtw_fw_c2h_cmd_handle_ext(rtwdev, skb);
+		break;
+	default:
+		return false;
+	}
+
+	rtw_fw_c2h_stat_update(rtwdev, skb, c2h->id);
+
+	return true;
+}
+
+void rtw_fw_c2h_cmd_handle(struct rtw_dev *rtwdev, struct sk_buff *skb)
+{
+	struct rtw_c2h_cmd *c2h;
+	u32 pkt_offset;
+	u8 len;
+
+	pkt_offset = *((u32 *)skb->cb);
+	c2h = (struct rtw_c2h_cmd *)(skb->data + pkt_offset);
+	len = skb->len - pkt_offset - 2;
+
+	mutex_lock(&rtwdev->mutex);
+
+	switch (c2h->id) {
 	case C2H_BT_INFO:
 		rtw_coex_bt_info_notify(rtwdev, c2h->payload, len);
 		break;
@@ -149,15 +201,14 @@ void rtw_fw_c2h_cmd_handle(struct rtw_dev *rtwdev, struct sk_buff *skb)
 	case C2H_HALMAC:
 		rtw_fw_c2h_cmd_handle_ext(rtwdev, skb);
 		break;
-	case C2H_RA_RPT:
-		rtw_fw_ra_report_handle(rtwdev, c2h->payload, len);
-		break;
 	default:
 		rtw_dbg(rtwdev, RTW_DBG_FW, "C2H 0x%x isn't handled\n", c2h->id);
 		break;
 	}
 
 	mutex_unlock(&rtwdev->mutex);
+
+	rtw_fw_c2h_stat_update(rtwdev, skb, c2h->id);
 }
 
 void rtw_fw_c2h_cmd_rx_irqsafe(struct rtw_dev *rtwdev, u32 pkt_offset,
@@ -169,6 +220,7 @@ void rtw_fw_c2h_cmd_rx_irqsafe(struct rtw_dev *rtwdev, u32 pkt_offset,
 	c2h = (struct rtw_c2h_cmd *)(skb->data + pkt_offset);
 	len = skb->len - pkt_offset - 2;
 	*((u32 *)skb->cb) = pkt_offset;
+	skb->tstamp = ktime_get();
 
 	rtw_dbg(rtwdev, RTW_DBG_FW, "recv C2H, id=0x%02x, seq=0x%02x, len=%d\n",
 		c2h->id, c2h->seq, len);
@@ -178,6 +230,11 @@ void rtw_fw_c2h_cmd_rx_irqsafe(struct rtw_dev *rtwdev, u32 pkt_offset,
 		rtw_coex_info_response(rtwdev, skb);
 		break;
 	default:
+		if (rtw_fw_c2h_cmd_handle_atomic(rtwdev, skb)) {
+			dev_kfree_skb_any(skb);
+			break;
+		}
+
 		/* pass offset for further operation */
 		*((u32 *)skb->cb) = pkt_offset;
 		skb_queue_tail(&rtwdev->c2h_queue, skb);
@@ -187,8 +244,7 @@ void rtw_fw_c2h_cmd_rx_irqsafe(struct rtw_dev *rtwdev, u32 pkt_offset,
 }
 EXPORT_SYMBOL(rtw_fw_c2h_cmd_rx_irqsafe);
 
-static void rtw_fw_send_h2c_command(struct rtw_dev *rtwdev,
-				    u8 *h2c)
+static bool rtw_fw_h2c_box_write(struct rtw_dev *rtwdev, const u8 *h2c)
 {
 	u8 box;
 	u8 box_state;
@@ -196,13 +252,6 @@ static void rtw_fw_send_h2c_command(struct rtw_dev *rtwdev,
 	u32 h2c_wait;
 	int idx;
 
-	rtw_dbg(rtwdev, RTW_DBG_FW,
-		"send H2C content %02x%02x%02x%02x %02x%02x%02x%02x\n",
-		h2c[3], h2c[2], h2c[1], h2c[0],
-		h2c[7], h2c[6], h2c[5], h2c[4]);
-
-	spin_lock(&rtwdev->h2c.lock);
-
 	box = rtwdev->h2c.last_box_num;
 	switch (box) {
 	case 0:
@@ -223,7 +272,7 @@ static void rtw_fw_send_h2c_command(struct rtw_dev *rtwdev,
 		break;
 	default:
 		WARN(1, "invalid h2c mail box number\n");
-		goto out;
+		return false;
 	}
 
 	h2c_wait = 20;
@@ -231,10 +280,9 @@ static void rtw_fw_send_h2c_command(struct rtw_dev *rtwdev,
 		box_state = rtw_read8(rtwdev, REG_HMETFR);
 	} while ((box_state >> box) & 0x1 && --h2c_wait > 0);
 
-	if (!h2c_wait) {
-		rtw_err(rtwdev, "failed to send h2c command\n");
-		goto out;
-	}
+	/* mail box is still occupied by firmware, try again later */
+	if (!h2c_wait)
+		return false;
 
 	for (idx = 0; idx < 4; idx++)
 		rtw_write8(rtwdev, box_reg + idx, h2c[idx]);
@@ -244,7 +292,145 @@ static void rtw_fw_send_h2c_command(struct rtw_dev *rtwdev,
 	if (++rtwdev->h2c.last_box_num >= 4)
 		rtwdev->h2c.last_box_num = 0;
 
-out:
+	return true;
+}
+
+static void rtw_fw_h2c_queue_drain(struct rtw_dev *rtwdev)
+{
+	struct rtw_h2c_cmd *cmd = rtwdev->h2c.queue;
+	u32 latency;
+
+	lockdep_assert_held(&rtwdev->h2c.lock);
+
+	while (rtwdev->h2c.queue_len) {
+		if (!rtw_fw_h2c_box_write(rtwdev, cmd->data))
+			break;
+
+		latency = ktime_us_delta(ktime_get(), cmd->queued);
+		rtwdev->h2c.sent_cnt++;
+		rtwdev->h2c.latency_sum_us += latency;
+		if (latency > rtwdev->h2c.latency_max_us)
+			rtwdev->h2c.latency_max_us = latency;
+
+		rtwdev->h2c.queue_len--;
+		memmove(cmd, cmd + 1, rtwdev->h2c.queue_len * sizeof(*cmd));
+	}
+
+	if (rtwdev->h2c.queue_len)
+		ieee80211_queue_delayed_work(rtwdev->hw, &rtwdev->h2c.work, 1);
+}
+
+/* A pending command which only carries the latest state of something,
+ * such as rssi of a macid, is superseded by a newer one of the same kind.
+ */
+static bool rtw_fw_h2c_superseded(const u8 *pending, const u8 *h2c)
+{
+	if (pending[0] != h2c[0])
+		return false;
+
+	switch (h2c[0]) {
+	case H2C_CMD_RSSI_MONITOR:
+	case H2C_CMD_RA_INFO:
+		/* macid is at the same location */
+		return pending[1] == h2c[1];
+	case H2C_CMD_WL_CH_INFO:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void rtw_fw_h2c_queue_add(struct rtw_dev *rtwdev, const u8 *h2c)
+{
+	struct rtw_h2c_cmd *queue = rtwdev->h2c.queue;
+	u8 i;
+
+	lockdep_assert_held(&rtwdev->h2c.lock);
+
+	/* drop the superseded one, and keep the order of the others */
+	for (i = 0; i < rtwdev->h2c.queue_len; i++) {
+		if (!rtw_fw_h2c_superseded(queue[i].data, h2c))
+			continue;
+
+		rtwdev->h2c.coalesce_cnt++;
+		rtwdev->h2c.queue_len--;
+		memmove(&queue[i], &queue[i + 1],
+			(rtwdev->h2c.queue_len - i) * sizeof(*queue));
+		break;
+	}
+
+	if (rtwdev->h2c.queue_len >= RTW_H2C_QUEUE_LEN) {
+		rtwdev->h2c.drop_cnt++;
+		rtw_err(rtwdev, "drop h2c command 0x%02x, queue is full\n",
+			h2c[0]);
+		return;
+	}
+
+	memcpy(queue[rtwdev->h2c.queue_len].data, h2c, RTW_H2C_BOX_SIZE);
+	queue[rtwdev->h2c.queue_len].queued = ktime_get();
+	rtwdev->h2c.queue_len++;
+}
+
+static void rtw_fw_send_h2c_command(struct rtw_dev *rtwdev,
+				    u8 *h2c)
+{
+	rtw_dbg(rtwdev, RTW_DBG_FW,
+		"send H2C content %02x%02x%02x%02x %02x%02x%02x%02x\n",
+		h2c[3], h2c[2], h2c[1], h2c[0],
+		h2c[7], h2c[6], h2c[5], h2c[4]);
+
+	spin_lock(&rtwdev->h2c.lock);
+
+	rtw_fw_h2c_queue_add(rtwdev, h2c);
+	rtw_fw_h2c_queue_drain(rtwdev);
+
+	spin_unlock(&rtwdev->h2c.lock);
+}
+
+void rtw_fw_h2c_work(struct work_struct *work)
+{
+	struct rtw_dev *rtwdev = container_of(work, struct rtw_dev,
+					      h2c.work.work);
+
+	/* deep PS is entered with h2c.lock held, and the mail box is not
+	 * accessible in deep PS, will be kicked on leaving
+	 */
+	spin_lock(&rtwdev->h2c.lock);
+	if (!test_bit(RTW_FLAG_LEISURE_PS_DEEP, rtwdev->flags))
+		rtw_fw_h2c_queue_drain(rtwdev);
+	spin_unlock(&rtwdev->h2c.lock);
+}
+
+/* send out the queued commands synchronously, returns false if firmware
+ * keeps the mail boxes busy
+ */
+bool rtw_fw_h2c_queue_flush(struct rtw_dev *rtwdev)
+{
+	bool empty;
+	int i;
+
+	for (i = 0; i < RTW_H2C_FLUSH_RETRY; i++) {
+		spin_lock(&rtwdev->h2c.lock);
+		rtw_fw_h2c_queue_drain(rtwdev);
+		empty = !rtwdev->h2c.queue_len;
+		spin_unlock(&rtwdev->h2c.lock);
+
+		if (empty)
+			return true;
+
+		usleep_range(100, 200);
+	}
+
+	return false;
+}
+
+void rtw_fw_h2c_queue_purge(struct rtw_dev *rtwdev)
+{
+	cancel_delayed_work_sync(&rtwdev->h2c.work);
+
+	spin_lock(&rtwdev->h2c.lock);
+	rtwdev->h2c.drop_cnt += rtwdev->h2c.queue_len;
+	rtwdev->h2c.queue_len = 0;
 	spin_unlock(&rtwdev->h2c.lock);
 }
 
@@ -933,9 +1119,6 @@ static void rtw_rsvd_page_list_to_buf(struct rtw_dev *rtwdev, u8 page_size,
 {
 	struct sk_buff *skb = rsvd_pkt->skb;
 
-	if (rsvd_pkt->add_txdesc)
-		rtw_fill_rsvd_page_desc(rtwdev, skb);
-
 	if (page >= 1)
 		memcpy(buf + page_margin + page_size * (page - 1),
 		       skb->data, skb->len);
@@ -1000,12 +1183,13 @@ void rtw_reset_rsvd_page(struct rtw_dev *rtwdev)
 		if (rsvd_pkt->type == RSVD_BEACON)
 			continue;
 		list_del(&rsvd_pkt->list);
+		kfree_skb(rsvd_pkt->skb);
 		kfree(rsvd_pkt);
 	}
 }
 
 int rtw_fw_write_data_rsvd_page(struct rtw_dev *rtwdev, u16 pg_addr,
-				u8 *buf, u32 size)
+				const u8 *buf, u32 size)
 {
 	u8 bckp[2];
 	u8 val;
@@ -1051,7 +1235,7 @@ int rtw_fw_write_data_rsvd_page(struct rtw_dev *rtwdev, u16 pg_addr,
 		bcn_valid_mask = BIT_BCN_VALID_V1;
 	}
 
-	if (!check_hw_ready(rtwdev, bcn_valid_addr, bcn_valid_mask, 1)) {
+	if (rtw_poll32(rtwdev, bcn_valid_addr, bcn_valid_mask, 1)) {
 		rtw_err(rtwdev, "error beacon valid\n");
 		ret = -EBUSY;
 	}
@@ -1079,9 +1263,42 @@ static int rtw_download_drv_rsvd_page(struct rtw_dev *rtwdev, u8 *buf, u32 size)
 
 	pg_addr = rtwdev->fifo.rsvd_drv_addr;
 
+	rtwdev->rsvd_page_cache.last_dl_bytes += size;
+
 	return rtw_fw_write_data_rsvd_page(rtwdev, pg_addr, buf, size);
 }
 
+/* Packets built from state that changes without the entry being re-added,
+ * such as beacon/TIM, security CAM and DPK results, are regenerated on each
+ * download. The others are built from vif and PNO settings that are fixed
+ * until rtw_fw_config_rsvd_page() re-creates the list, so the built skb is
+ * kept in the entry and reused.
+ */
+static bool rtw_rsvd_page_is_volatile(enum rtw_rsvd_packet_type type)
+{
+	switch (type) {
+	case RSVD_BEACON:
+	case RSVD_PROBE_RESP:
+	case RSVD_LPS_PG_DPK:
+	case RSVD_LPS_PG_INFO:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void rtw_rsvd_page_release_skb(struct rtw_dev *rtwdev)
+{
+	struct rtw_rsvd_page *rsvd_pkt;
+
+	list_for_each_entry(rsvd_pkt, &rtwdev->rsvd_page_list, list) {
+		if (!rtw_rsvd_page_is_volatile(rsvd_pkt->type))
+			continue;
+		kfree_skb(rsvd_pkt->skb);
+		rsvd_pkt->skb = NULL;
+	}
+}
+
 static u8 *rtw_build_rsvd_page(struct rtw_dev *rtwdev,
 			       struct ieee80211_vif *vif, u32 *size)
 {
@@ -1099,18 +1316,18 @@ static u8 *rtw_build_rsvd_page(struct rtw_dev *rtwdev,
 	page_margin = page_size - tx_desc_sz;
 
 	list_for_each_entry(rsvd_pkt, &rtwdev->rsvd_page_list, list) {
-		iter = rtw_get_rsvd_page_skb(hw, vif, rsvd_pkt);
-		if (!iter) {
-			rtw_err(rtwdev, "fail to build rsvd packet\n");
-			goto release_skb;
+		if (!rsvd_pkt->skb) {
+			iter = rtw_get_rsvd_page_skb(hw, vif, rsvd_pkt);
+			if (!iter) {
+				rtw_err(rtwdev, "fail to build rsvd packet\n");
+				goto release_skb;
+			}
+			if (rsvd_pkt->add_txdesc)
+				rtw_fill_rsvd_page_desc(rtwdev, iter);
+			rsvd_pkt->skb = iter;
 		}
-		rsvd_pkt->skb = iter;
 		rsvd_pkt->page = total_page;
-		if (rsvd_pkt->add_txdesc)
-			total_page += rtw_len_to_page(iter->len + tx_desc_sz,
-						      page_size);
-		else
-			total_page += rtw_len_to_page(iter->len, page_size);
+		total_page += rtw_len_to_page(rsvd_pkt->skb->len, page_size);
 	}
 
 	if (total_page > rtwdev->fifo.rsvd_drv_pg_num) {
@@ -1128,14 +1345,12 @@ static u8 *rtw_build_rsvd_page(struct rtw_dev *rtwdev,
 					  page, buf, rsvd_pkt);
 		page += rtw_len_to_page(rsvd_pkt->skb->len, page_size);
 	}
-	list_for_each_entry(rsvd_pkt, &rtwdev->rsvd_page_list, list)
-		kfree_skb(rsvd_pkt->skb);
+	rtw_rsvd_page_release_skb(rtwdev);
 
 	return buf;
 
 release_skb:
-	list_for_each_entry(rsvd_pkt, &rtwdev->rsvd_page_list, list)
-		kfree_skb(rsvd_pkt->skb);
+	rtw_rsvd_page_release_skb(rtwdev);
 
 	return NULL;
 }
@@ -1164,11 +1379,71 @@ out:
 	return ret;
 }
 
+static u8 rtw_rsvd_page_bcn_page_num(struct rtw_dev *rtwdev)
+{
+	struct rtw_rsvd_page *rsvd_pkt;
+
+	/* beacon is always the first one in the list */
+	list_for_each_entry(rsvd_pkt, &rtwdev->rsvd_page_list, list) {
+		if (rsvd_pkt->type != RSVD_BEACON)
+			return rsvd_pkt->page;
+	}
+
+	return U8_MAX;
+}
+
+/* Compare each page of buf with what was downloaded last time, and return
+ * the size from the head of buf to the end of the last changed page.
+ * Pages of beacon are skipped since rtw_download_beacon() refreshes them.
+ */
+static u32 rtw_rsvd_page_cache_update(struct rtw_dev *rtwdev, u8 *buf,
+				      u32 size)
+{
+	struct rtw_rsvd_page_cache *cache = &rtwdev->rsvd_page_cache;
+	struct rtw_chip_info *chip = rtwdev->chip;
+	u8 page_size = chip->page_size;
+	u8 page_margin = page_size - chip->tx_pkt_desc_sz;
+	u8 bcn_page_num = rtw_rsvd_page_bcn_page_num(rtwdev);
+	u32 page_num = (size - page_margin) / page_size + 1;
+	u32 offset, len, crc;
+	u32 dl_size = 0;
+	u32 page;
+
+	if (WARN_ON(page_num > RTW_RSVD_PG_CACHE_NUM)) {
+		cache->valid = false;
+		return size;
+	}
+
+	for (page = 0; page < page_num; page++) {
+		if (page == 0) {
+			offset = 0;
+			len = page_margin;
+		} else {
+			offset = page_margin + page_size * (page - 1);
+			len = page_size;
+		}
+
+		crc = crc32_le(~0, buf + offset, len);
+		if (page >= bcn_page_num &&
+		    (!cache->valid || page >= cache->page_num ||
+		     cache->crc[page] != crc))
+			dl_size = offset + len;
+
+		cache->crc[page] = crc;
+	}
+	cache->page_num = page_num;
+
+	return dl_size;
+}
+
 int rtw_fw_download_rsvd_page(struct rtw_dev *rtwdev, struct ieee80211_vif *vif)
 {
+	struct rtw_rsvd_page_cache *cache = &rtwdev->rsvd_page_cache;
 	u8 *buf;
 	u32 size;
-	int ret;
+	int ret = 0;
+
+	cache->last_dl_bytes = 0;
 
 	buf = rtw_build_rsvd_page(rtwdev, vif, &size);
 	if (!buf) {
@@ -1176,10 +1451,13 @@ int rtw_fw_download_rsvd_page(struct rtw_dev *rtwdev, struct ieee80211_vif *vif)
 		return -ENOMEM;
 	}
 
-	ret = rtw_download_drv_rsvd_page(rtwdev, buf, size);
-	if (ret) {
-		rtw_err(rtwdev, "failed to download drv rsvd page\n");
-		goto free;
+	size = rtw_rsvd_page_cache_update(rtwdev, buf, size);
+	if (size) {
+		ret = rtw_download_drv_rsvd_page(rtwdev, buf, size);
+		if (ret) {
+			rtw_err(rtwdev, "failed to download drv rsvd page\n");
+			goto free;
+		}
 	}
 
 	ret = rtw_download_beacon(rtwdev, vif);
@@ -1189,11 +1467,19 @@ int rtw_fw_download_rsvd_page(struct rtw_dev *rtwdev, struct ieee80211_vif *vif)
 	}
 
 free:
+	cache->valid = !ret;
+	cache->dl_cnt++;
+	cache->total_dl_bytes += cache->last_dl_bytes;
 	kfree(buf);
 
 	return ret;
 }
 
+void rtw_fw_rsvd_page_cache_invalidate(struct rtw_dev *rtwdev)
+{
+	rtwdev->rsvd_page_cache.valid = false;
+}
+
 int rtw_dump_drv_rsvd_page(struct rtw_dev *rtwdev,
 			   u32 offset, u32 size, u32 *buf)
 {
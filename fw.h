@@ -102,6 +102,7 @@ struct rtw_lps_pg_info_hdr {
 
 struct rtw_rsvd_page {
 	struct list_head list;
+	/* built packet with tx desc, kept across downloads unless volatile */
 	struct sk_buff *skb;
 	enum rtw_rsvd_packet_type type;
 	u8 page;
@@ -499,6 +500,10 @@ static inline struct rtw_c2h_cmd *get_c2h_from_skb(struct sk_buff *skb)
 void rtw_fw_c2h_cmd_rx_irqsafe(struct rtw_dev *rtwdev, u32 pkt_offset,
 			       struct sk_buff *skb);
 void rtw_fw_c2h_cmd_handle(struct rtw_dev *rtwdev, struct sk_buff *skb);
+void rtw_fw_h2c_work(struct work_struct *work);
+void rtw_fw_rsvd_page_cache_invalidate(struct rtw_dev *rtwdev);
+void rtw_fw_h2c_queue_purge(struct rtw_dev *rtwdev);
+bool rtw_fw_h2c_queue_flush(struct rtw_dev *rtwdev);
 void rtw_fw_send_general_info(struct rtw_dev *rtwdev);
 void rtw_fw_send_phydm_info(struct rtw_dev *rtwdev);
 
@@ -522,7 +527,7 @@ void rtw_add_rsvd_page(struct rtw_dev *rtwdev, enum rtw_rsvd_packet_type type,
 void rtw_add_rsvd_page_probe_req(struct rtw_dev *rtwdev,
 				 struct cfg80211_ssid *ssid);
 int rtw_fw_write_data_rsvd_page(struct rtw_dev *rtwdev, u16 pg_addr,
-				u8 *buf, u32 size);
+				const u8 *buf, u32 size);
 void rtw_reset_rsvd_page(struct rtw_dev *rtwdev);
 int rtw_fw_download_rsvd_page(struct rtw_dev *rtwdev,
 			      struct ieee80211_vif *vif);
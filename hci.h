@@ -16,8 +16,10 @@ struct rtw_hci_ops {
 	int (*start)(struct rtw_dev *rtwdev);
 	void (*stop)(struct rtw_dev *rtwdev);
 	void (*deep_ps)(struct rtw_dev *rtwdev, bool enter);
+	int (*flush_queues)(struct rtw_dev *rtwdev, u32 queues, bool drop);
 
-	int (*write_data_rsvd_page)(struct rtw_dev *rtwdev, u8 *buf, u32 size);
+	int (*write_data_rsvd_page)(struct rtw_dev *rtwdev, const u8 *buf,
+				    u32 size);
 	int (*write_data_h2c)(struct rtw_dev *rtwdev, u8 *buf, u32 size);
 
 	u8 (*read8)(struct rtw_dev *rtwdev, u32 addr);
@@ -26,6 +28,13 @@ struct rtw_hci_ops {
 	void (*write8)(struct rtw_dev *rtwdev, u32 addr, u8 val);
 	void (*write16)(struct rtw_dev *rtwdev, u32 addr, u16 val);
 	void (*write32)(struct rtw_dev *rtwdev, u32 addr, u32 val);
+
+	/* optional, burst write of count dwords in memory order */
+	void (*write_block32)(struct rtw_dev *rtwdev, u32 addr,
+			      const __le32 *data, u32 count);
+	/* optional, num writes of 1/2/4 bytes in order, posted as a whole */
+	void (*write_batch)(struct rtw_dev *rtwdev,
+			    const struct rtw_backup_info *regs, u32 num);
 };
 
 static inline int rtw_hci_tx(struct rtw_dev *rtwdev,
@@ -61,8 +70,17 @@ static inline void rtw_hci_deep_ps(struct rtw_dev *rtwdev, bool enter)
 	rtwdev->hci.ops->deep_ps(rtwdev, enter);
 }
 
+static inline int rtw_hci_flush_queues(struct rtw_dev *rtwdev, u32 queues,
+				       bool drop)
+{
+	if (!rtwdev->hci.ops->flush_queues)
+		return 0;
+
+	return rtwdev->hci.ops->flush_queues(rtwdev, queues, drop);
+}
+
 static inline int
-rtw_hci_write_data_rsvd_page(struct rtw_dev *rtwdev, u8 *buf, u32 size)
+rtw_hci_write_data_rsvd_page(struct rtw_dev *rtwdev, const u8 *buf, u32 size)
 {
 	return rtwdev->hci.ops->write_data_rsvd_page(rtwdev, buf, size);
 }
@@ -103,6 +121,47 @@ static inline void rtw_write32(struct rtw_dev *rtwdev, u32 addr, u32 val)
 	rtwdev->hci.ops->write32(rtwdev, addr, val);
 }
 
+static inline void rtw_write_block32(struct rtw_dev *rtwdev, u32 addr,
+				     const __le32 *data, u32 count)
+{
+	u32 i;
+
+	if (rtwdev->hci.ops->write_block32) {
+		rtwdev->hci.ops->write_block32(rtwdev, addr, data, count);
+		return;
+	}
+
+	for (i = 0; i < count; i++, addr += 4)
+		rtw_write32(rtwdev, addr, le32_to_cpu(data[i]));
+}
+
+static inline void rtw_write_batch(struct rtw_dev *rtwdev,
+				   const struct rtw_backup_info *regs, u32 num)
+{
+	u32 i;
+
+	if (rtwdev->hci.ops->write_batch) {
+		rtwdev->hci.ops->write_batch(rtwdev, regs, num);
+		return;
+	}
+
+	for (i = 0; i < num; i++, regs++) {
+		switch (regs->len) {
+		case 1:
+			rtw_write8(rtwdev, regs->reg, (u8)regs->val);
+			break;
+		case 2:
+			rtw_write16(rtwdev, regs->reg, (u16)regs->val);
+			break;
+		case 4:
+			rtw_write32(rtwdev, regs->reg, regs->val);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
 static inline void rtw_write8_set(struct rtw_dev *rtwdev, u32 addr, u8 bit)
 {
 	u8 val;
@@ -159,7 +218,10 @@ rtw_read_rf(struct rtw_dev *rtwdev, enum rtw_rf_path rf_path,
 	u32 val;
 
 	spin_lock_irqsave(&rtwdev->rf_lock, flags);
-	val = rtwdev->chip->ops->read_rf(rtwdev, rf_path, addr, mask);
+	if (rtwdev->chip->rf_volatile_regs)
+		val = rtw_rf_shadow_read(rtwdev, rf_path, addr, mask);
+	else
+		val = rtwdev->chip->ops->read_rf(rtwdev, rf_path, addr, mask);
 	spin_unlock_irqrestore(&rtwdev->rf_lock, flags);
 
 	return val;
@@ -172,7 +234,10 @@ rtw_write_rf(struct rtw_dev *rtwdev, enum rtw_rf_path rf_path,
 	unsigned long flags;
 
 	spin_lock_irqsave(&rtwdev->rf_lock, flags);
-	rtwdev->chip->ops->write_rf(rtwdev, rf_path, addr, mask, data);
+	if (rtwdev->chip->rf_volatile_regs)
+		rtw_rf_shadow_write(rtwdev, rf_path, addr, mask, data);
+	else
+		rtwdev->chip->ops->write_rf(rtwdev, rf_path, addr, mask, data);
 	spin_unlock_irqrestore(&rtwdev->rf_lock, flags);
 }
 
@@ -2,6 +2,7 @@
 /* Copyright(c) 2018-2019  Realtek Corporation
  */
 
+#include <linux/iopoll.h>
 #include "main.h"
 #include "mac.h"
 #include "reg.h"
@@ -15,6 +16,9 @@ void rtw_set_channel_mac(struct rtw_dev *rtwdev, u8 channel, u8 bw,
 	u32 value32;
 	u8 value8;
 
+	if (rtwdev->hal.chsw.bw_unchanged)
+		return;
+
 	txsc20 = primary_ch_idx;
 	if (bw == RTW_CHANNEL_WIDTH_80) {
 		if (txsc20 == RTW_SC_20_UPPER || txsc20 == RTW_SC_20_UPPERST)
@@ -113,30 +117,20 @@ static int rtw_mac_pre_system_cfg(struct rtw_dev *rtwdev)
 
 static bool do_pwr_poll_cmd(struct rtw_dev *rtwdev, u32 addr, u32 mask, u32 target)
 {
-	u32 cnt;
+	u8 val;
 
 	target &= mask;
 
-	for (cnt = 0; cnt < RTW_PWR_POLLING_CNT; cnt++) {
-		if ((rtw_read8(rtwdev, addr) & mask) == target)
-			return true;
-
-		udelay(50);
-	}
-
-	return false;
+	return !read_poll_timeout(rtw_read8, val, (val & mask) == target,
+				  50, RTW_PWR_POLLING_CNT * 50, false,
+				  rtwdev, addr);
 }
 
 static int rtw_pwr_cmd_polling(struct rtw_dev *rtwdev,
-			       struct rtw_pwr_seq_cmd *cmd)
+			       struct rtw_pwr_prog_cmd *cmd)
 {
+	u32 offset = cmd->offset;
 	u8 value;
-	u32 offset;
-
-	if (cmd->base == RTW_PWR_ADDR_SDIO)
-		offset = cmd->offset | SDIO_LOCAL_OFFSET;
-	else
-		offset = cmd->offset;
 
 	if (do_pwr_poll_cmd(rtwdev, offset, cmd->mask, cmd->value))
 		return 0;
@@ -162,41 +156,175 @@ err:
 	return -EBUSY;
 }
 
-static int rtw_sub_pwr_seq_parser(struct rtw_dev *rtwdev, u8 intf_mask,
-				  u8 cut_mask, struct rtw_pwr_seq_cmd *cmd)
+static u32 rtw_pwr_seq_cmd_num(struct rtw_pwr_seq_cmd **cmd_seq)
+{
+	struct rtw_pwr_seq_cmd *cmd;
+	u32 num = 0;
+	u32 idx;
+
+	for (idx = 0; cmd_seq[idx]; idx++)
+		for (cmd = cmd_seq[idx]; cmd->cmd != RTW_PWR_CMD_END; cmd++)
+			num++;
+
+	return num;
+}
+
+/* Polls wait for a trigger written before them to take effect, such as
+ * APFM_ONMAC/APFM_OFF, on the same offset
+ */
+static bool rtw_pwr_seq_polled(struct rtw_pwr_seq_cmd **cmd_seq,
+			       u8 intf_mask, u8 cut_mask, u32 offset)
+{
+	struct rtw_pwr_seq_cmd *cmd;
+	u32 idx;
+
+	for (idx = 0; cmd_seq[idx]; idx++) {
+		for (cmd = cmd_seq[idx]; cmd->cmd != RTW_PWR_CMD_END; cmd++) {
+			if (cmd->cmd != RTW_PWR_CMD_POLLING ||
+			    !(cmd->intf_mask & intf_mask) ||
+			    !(cmd->cut_mask & cut_mask))
+				continue;
+
+			if ((cmd->base == RTW_PWR_ADDR_SDIO ?
+			     cmd->offset | SDIO_LOCAL_OFFSET : cmd->offset) ==
+			    offset)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+/* Writes to the same register with disjoint masks are merged into one,
+ * except for REG_SYS_PW_CTRL (APS_FSMCO, 0x04~0x07), where the vendor
+ * sequences release suspend/HWPDN, set AFSM/PCIe bits and trigger
+ * APFM_ONMAC/APFM_OFF in separate steps. The caller also keeps writes to
+ * a polled offset apart, see rtw_pwr_seq_polled().
+ */
+static bool rtw_pwr_prog_merge_write(struct rtw_pwr_prog_cmd *last,
+				     u32 offset, u8 mask, u8 value)
 {
-	struct rtw_pwr_seq_cmd *cur_cmd;
+	if (last->cmd != RTW_PWR_CMD_WRITE || last->offset != offset ||
+	    last->mask & mask)
+		return false;
+
+	if (offset >= REG_SYS_PW_CTRL && offset <= REG_SYS_PW_CTRL + 3)
+		return false;
+
+	last->mask |= mask;
+	last->value = (last->value & ~mask) | (value & mask);
+
+	return true;
+}
+
+static int rtw_pwr_prog_compile(struct rtw_dev *rtwdev,
+				struct rtw_pwr_prog *prog,
+				struct rtw_pwr_seq_cmd **cmd_seq)
+{
+	struct rtw_pwr_prog_cmd *cmds, *out;
+	struct rtw_pwr_seq_cmd *cmd;
+	u8 cut = rtwdev->hal.cut_version;
+	u8 cut_mask = cut_version_to_mask(cut);
+	u8 intf_mask;
 	u32 offset;
-	u8 value;
+	u32 idx;
+	u32 n = 0;
 
-	for (cur_cmd = cmd; cur_cmd->cmd != RTW_PWR_CMD_END; cur_cmd++) {
-		if (!(cur_cmd->intf_mask & intf_mask) ||
-		    !(cur_cmd->cut_mask & cut_mask))
-			continue;
+	switch (rtw_hci_type(rtwdev)) {
+	case RTW_HCI_TYPE_PCIE:
+		intf_mask = BIT(2);
+		break;
+	case RTW_HCI_TYPE_USB:
+		intf_mask = BIT(1);
+		break;
+	default:
+		return -EINVAL;
+	}
 
-		switch (cur_cmd->cmd) {
-		case RTW_PWR_CMD_WRITE:
-			offset = cur_cmd->offset;
+	cmds = kcalloc(max_t(u32, 1, rtw_pwr_seq_cmd_num(cmd_seq)),
+		       sizeof(*cmds), GFP_KERNEL);
+	if (!cmds)
+		return -ENOMEM;
 
-			if (cur_cmd->base == RTW_PWR_ADDR_SDIO)
-				offset |= SDIO_LOCAL_OFFSET;
+	for (idx = 0; cmd_seq[idx]; idx++) {
+		for (cmd = cmd_seq[idx]; cmd->cmd != RTW_PWR_CMD_END; cmd++) {
+			if (!(cmd->intf_mask & intf_mask) ||
+			    !(cmd->cut_mask & cut_mask))
+				continue;
+
+			offset = cmd->offset;
+
+			switch (cmd->cmd) {
+			case RTW_PWR_CMD_WRITE:
+			case RTW_PWR_CMD_POLLING:
+				if (cmd->base == RTW_PWR_ADDR_SDIO)
+					offset |= SDIO_LOCAL_OFFSET;
+				break;
+			case RTW_PWR_CMD_DELAY:
+				break;
+			case RTW_PWR_CMD_READ:
+				continue;
+			default:
+				kfree(cmds);
+				return -EINVAL;
+			}
+
+			if (cmd->cmd == RTW_PWR_CMD_WRITE && n &&
+			    !rtw_pwr_seq_polled(cmd_seq, intf_mask, cut_mask,
+						offset) &&
+			    rtw_pwr_prog_merge_write(&cmds[n - 1], offset,
+						     cmd->mask, cmd->value))
+				continue;
+
+			out = &cmds[n++];
+			out->offset = offset;
+			out->cmd = cmd->cmd;
+			out->mask = cmd->mask;
+			out->value = cmd->value;
+		}
+	}
+
+	kfree(prog->cmds);
+	prog->cmds = cmds;
+	prog->num = n;
+	prog->cut = cut;
+	prog->compiled = true;
+
+	rtw_dbg(rtwdev, RTW_DBG_PS, "power sequence compiled to %u cmds\n", n);
+
+	return 0;
+}
 
-			value = rtw_read8(rtwdev, offset);
-			value &= ~cur_cmd->mask;
-			value |= (cur_cmd->value & cur_cmd->mask);
-			rtw_write8(rtwdev, offset, value);
+static int rtw_pwr_prog_run(struct rtw_dev *rtwdev, struct rtw_pwr_prog *prog)
+{
+	struct rtw_pwr_prog_cmd *cmd;
+	u8 value;
+	u32 i;
+
+	for (i = 0; i < prog->num; i++) {
+		cmd = &prog->cmds[i];
+
+		switch (cmd->cmd) {
+		case RTW_PWR_CMD_WRITE:
+			if (cmd->mask == 0xff) {
+				rtw_write8(rtwdev, cmd->offset, cmd->value);
+				break;
+			}
+
+			value = rtw_read8(rtwdev, cmd->offset);
+			value &= ~cmd->mask;
+			value |= (cmd->value & cmd->mask);
+			rtw_write8(rtwdev, cmd->offset, value);
 			break;
 		case RTW_PWR_CMD_POLLING:
-			if (rtw_pwr_cmd_polling(rtwdev, cur_cmd))
+			if (rtw_pwr_cmd_polling(rtwdev, cmd))
 				return -EBUSY;
 			break;
 		case RTW_PWR_CMD_DELAY:
-			if (cur_cmd->value == RTW_PWR_DELAY_US)
-				udelay(cur_cmd->offset);
+			if (cmd->value == RTW_PWR_DELAY_US)
+				udelay(cmd->offset);
 			else
-				mdelay(cur_cmd->offset);
-			break;
-		case RTW_PWR_CMD_READ:
+				mdelay(cmd->offset);
 			break;
 		default:
 			return -EINVAL;
@@ -206,48 +334,57 @@ static int rtw_sub_pwr_seq_parser(struct rtw_dev *rtwdev, u8 intf_mask,
 	return 0;
 }
 
-static int rtw_pwr_seq_parser(struct rtw_dev *rtwdev,
-			      struct rtw_pwr_seq_cmd **cmd_seq)
+static int rtw_pwr_seq_parser(struct rtw_dev *rtwdev, bool pwr_on)
 {
-	u8 cut_mask;
-	u8 intf_mask;
-	u8 cut;
-	u32 idx = 0;
-	struct rtw_pwr_seq_cmd *cmd;
+	struct rtw_chip_info *chip = rtwdev->chip;
+	struct rtw_pwr_prog *prog;
+	struct rtw_pwr_seq_cmd **cmd_seq;
+	ktime_t start;
+	u32 time_us;
 	int ret;
 
-	cut = rtwdev->hal.cut_version;
-	cut_mask = cut_version_to_mask(cut);
-	switch (rtw_hci_type(rtwdev)) {
-	case RTW_HCI_TYPE_PCIE:
-		intf_mask = BIT(2);
-		break;
-	case RTW_HCI_TYPE_USB:
-		intf_mask = BIT(1);
-		break;
-	default:
-		return -EINVAL;
+	if (pwr_on) {
+		prog = &rtwdev->pwr_on_prog;
+		cmd_seq = chip->pwr_on_seq;
+	} else {
+		prog = &rtwdev->pwr_off_prog;
+		cmd_seq = chip->pwr_off_seq;
 	}
 
-	do {
-		cmd = cmd_seq[idx];
-		if (!cmd)
-			break;
-
-		ret = rtw_sub_pwr_seq_parser(rtwdev, intf_mask, cut_mask, cmd);
+	/* compiled at the first power switch, again if the cut changes */
+	if (!prog->compiled || prog->cut != rtwdev->hal.cut_version) {
+		ret = rtw_pwr_prog_compile(rtwdev, prog, cmd_seq);
 		if (ret)
-			return -EBUSY;
+			return ret;
+	}
+
+	start = ktime_get();
+	ret = rtw_pwr_prog_run(rtwdev, prog);
+	if (ret)
+		return ret;
 
-		idx++;
-	} while (1);
+	time_us = ktime_us_delta(ktime_get(), start);
+	prog->cnt++;
+	prog->last_us = time_us;
+	prog->max_us = max(prog->max_us, time_us);
+	prog->total_us += time_us;
 
 	return 0;
 }
 
+void rtw_mac_pwr_prog_free(struct rtw_dev *rtwdev)
+{
+	kfree(rtwdev->pwr_on_prog.cmds);
+	rtwdev->pwr_on_prog.cmds = NULL;
+	rtwdev->pwr_on_prog.compiled = false;
+
+	kfree(rtwdev->pwr_off_prog.cmds);
+	rtwdev->pwr_off_prog.cmds = NULL;
+	rtwdev->pwr_off_prog.compiled = false;
+}
+
 static int rtw_mac_power_switch(struct rtw_dev *rtwdev, bool pwr_on)
 {
-	struct rtw_chip_info *chip = rtwdev->chip;
-	struct rtw_pwr_seq_cmd **pwr_seq;
 	u8 rpwm;
 	bool cur_pwr;
 
@@ -274,8 +411,7 @@ pwr_status:
 	if (pwr_on == cur_pwr)
 		return -EALREADY;
 
-	pwr_seq = pwr_on ? chip->pwr_on_seq : chip->pwr_off_seq;
-	if (rtw_pwr_seq_parser(rtwdev, pwr_seq))
+	if (rtw_pwr_seq_parser(rtwdev, pwr_on))
 		return -EINVAL;
 
 	return 0;
@@ -346,6 +482,20 @@ err:
 void rtw_mac_power_off(struct rtw_dev *rtwdev)
 {
 	rtw_mac_power_switch(rtwdev, false);
+	rtw_fw_rsvd_page_cache_invalidate(rtwdev);
+	rtw_rf_shadow_invalidate(rtwdev);
+}
+
+static void rtw_fw_dl_time_update(struct rtw_dev *rtwdev,
+				  struct rtw_fw_state *fw, ktime_t start)
+{
+	fw->dl_time_us = ktime_us_delta(ktime_get(), start);
+	fw->dl_cnt++;
+
+	rtw_dbg(rtwdev, RTW_DBG_FW,
+		"fw download %u us (txbuf %u, ddma %u, validate %u)\n",
+		fw->dl_time_us, fw->dl_txbuf_us, fw->dl_ddma_us,
+		fw->dl_validate_us);
 }
 
 static bool check_firmware_size(const u8 *data, u32 size)
@@ -458,21 +608,6 @@ static void download_firmware_reg_restore(struct rtw_dev *rtwdev,
 
 #define TX_DESC_SIZE 48
 
-static int send_firmware_pkt_rsvd_page(struct rtw_dev *rtwdev, u16 pg_addr,
-				       const u8 *data, u32 size)
-{
-	u8 *buf;
-	int ret;
-
-	buf = kmemdup(data, size, GFP_KERNEL);
-	if (!buf)
-		return -ENOMEM;
-
-	ret = rtw_fw_write_data_rsvd_page(rtwdev, pg_addr, buf, size);
-	kfree(buf);
-	return ret;
-}
-
 static int
 send_firmware_pkt(struct rtw_dev *rtwdev, u16 pg_addr, const u8 *data, u32 size)
 {
@@ -482,40 +617,43 @@ send_firmware_pkt(struct rtw_dev *rtwdev, u16 pg_addr, const u8 *data, u32 size)
 	    !((size + TX_DESC_SIZE) & (512 - 1)))
 		size += 1;
 
-	ret = send_firmware_pkt_rsvd_page(rtwdev, pg_addr, data, size);
+	ret = rtw_fw_write_data_rsvd_page(rtwdev, pg_addr, data, size);
 	if (ret)
 		rtw_err(rtwdev, "failed to download rsvd page\n");
 
 	return ret;
 }
 
-static int
-iddma_enable(struct rtw_dev *rtwdev, u32 src, u32 dst, u32 ctrl)
+static int iddma_wait(struct rtw_dev *rtwdev, struct rtw_fw_state *fw)
 {
-	rtw_write32(rtwdev, REG_DDMA_CH0SA, src);
-	rtw_write32(rtwdev, REG_DDMA_CH0DA, dst);
-	rtw_write32(rtwdev, REG_DDMA_CH0CTRL, ctrl);
+	ktime_t start = ktime_get();
+	int ret;
 
-	if (!check_hw_ready(rtwdev, REG_DDMA_CH0CTRL, BIT_DDMACH0_OWN, 0))
-		return -EBUSY;
+	ret = rtw_poll32(rtwdev, REG_DDMA_CH0CTRL, BIT_DDMACH0_OWN, 0);
+	fw->dl_ddma_us += ktime_us_delta(ktime_get(), start);
 
-	return 0;
+	return ret ? -EBUSY : 0;
 }
 
-static int iddma_download_firmware(struct rtw_dev *rtwdev, u32 src, u32 dst,
+/* Kick DDMA to copy from TXBUF to IMEM/DMEM without waiting for it to
+ * complete, so the next chunk can be sent to TXBUF meanwhile.
+ */
+static int iddma_download_firmware(struct rtw_dev *rtwdev,
+				   struct rtw_fw_state *fw, u32 src, u32 dst,
 				   u32 len, u8 first)
 {
 	u32 ch0_ctrl = BIT_DDMACH0_CHKSUM_EN | BIT_DDMACH0_OWN;
 
-	if (!check_hw_ready(rtwdev, REG_DDMA_CH0CTRL, BIT_DDMACH0_OWN, 0))
+	if (iddma_wait(rtwdev, fw))
 		return -EBUSY;
 
 	ch0_ctrl |= len & BIT_MASK_DDMACH0_DLEN;
 	if (!first)
 		ch0_ctrl |= BIT_DDMACH0_CHKSUM_CONT;
 
-	if (iddma_enable(rtwdev, src, dst, ch0_ctrl))
-		return -EBUSY;
+	rtw_write32(rtwdev, REG_DDMA_CH0SA, src);
+	rtw_write32(rtwdev, REG_DDMA_CH0DA, dst);
+	rtw_write32(rtwdev, REG_DDMA_CH0CTRL, ch0_ctrl);
 
 	return 0;
 }
@@ -554,9 +692,12 @@ check_fw_checksum(struct rtw_dev *rtwdev, u32 addr)
 	return true;
 }
 
+/* Chunks are staged alternately in two areas of TXBUF, so chunk N+1 is
+ * sent to TXBUF while DDMA is still copying chunk N to IMEM/DMEM.
+ */
 static int
-download_firmware_to_mem(struct rtw_dev *rtwdev, const u8 *data,
-			 u32 src, u32 dst, u32 size)
+download_firmware_to_mem(struct rtw_dev *rtwdev, struct rtw_fw_state *fw,
+			 const u8 *data, u32 src, u32 dst, u32 size)
 {
 	struct rtw_chip_info *chip = rtwdev->chip;
 	u32 desc_size = chip->tx_pkt_desc_sz;
@@ -565,6 +706,10 @@ download_firmware_to_mem(struct rtw_dev *rtwdev, const u8 *data,
 	u32 residue_size;
 	u32 pkt_size;
 	u32 max_size = 0x1000;
+	u32 stage_size = ALIGN(max_size + desc_size, chip->page_size);
+	u32 stage_src;
+	u8 stage = 0;
+	ktime_t start;
 	u32 val;
 	int ret;
 
@@ -582,23 +727,32 @@ download_firmware_to_mem(struct rtw_dev *rtwdev, const u8 *data,
 		else
 			pkt_size = residue_size;
 
-		ret = send_firmware_pkt(rtwdev, (u16)(src >> 7),
+		stage_src = src + stage * stage_size;
+
+		start = ktime_get();
+		ret = send_firmware_pkt(rtwdev, (u16)(stage_src >> 7),
 					data + mem_offset, pkt_size);
+		fw->dl_txbuf_us += ktime_us_delta(ktime_get(), start);
 		if (ret)
 			return ret;
 
-		ret = iddma_download_firmware(rtwdev, OCPBASE_TXBUF_88XX +
-					      src + desc_size,
+		ret = iddma_download_firmware(rtwdev, fw, OCPBASE_TXBUF_88XX +
+					      stage_src + desc_size,
 					      dst + mem_offset, pkt_size,
 					      first_part);
 		if (ret)
 			return ret;
 
+		stage ^= 1;
 		first_part = 0;
 		mem_offset += pkt_size;
 		residue_size -= pkt_size;
 	}
 
+	ret = iddma_wait(rtwdev, fw);
+	if (ret)
+		return ret;
+
 	if (!check_fw_checksum(rtwdev, dst))
 		return -EINVAL;
 
@@ -629,64 +783,105 @@ static void _update_firmware_info_legacy(struct rtw_dev *rtwdev,
 	fw->sub_index = legacy->subversion2;
 }
 
-static void update_firmware_info(struct rtw_dev *rtwdev,
-				 struct rtw_fw_state *fw)
+static void fw_section_set(struct rtw_fw_section *section, const u8 *data,
+			   u32 addr, u32 size)
+{
+	section->data = data;
+	section->addr = addr;
+	section->size = size;
+}
+
+static int _parse_firmware(struct rtw_dev *rtwdev, struct rtw_fw_state *fw)
 {
+	const u8 *data = fw->firmware->data;
+	const struct rtw_fw_hdr *fw_hdr = (const struct rtw_fw_hdr *)data;
+	const u8 *cur_fw = data + FW_HDR_SIZE;
+	u32 dmem_size;
+	u32 imem_size;
+	u32 emem_size;
+
+	if (!check_firmware_size(data, fw->firmware->size))
+		return -EINVAL;
+
+	dmem_size = le32_to_cpu(fw_hdr->dmem_size) + FW_HDR_CHKSUM_SIZE;
+	imem_size = le32_to_cpu(fw_hdr->imem_size) + FW_HDR_CHKSUM_SIZE;
+	emem_size = (fw_hdr->mem_usage & BIT(4)) ?
+		    le32_to_cpu(fw_hdr->emem_size) + FW_HDR_CHKSUM_SIZE : 0;
+
+	fw_section_set(&fw->section[RTW_FW_SECTION_DMEM], cur_fw,
+		       le32_to_cpu(fw_hdr->dmem_addr) & ~BIT(31), dmem_size);
+	cur_fw += dmem_size;
+	fw_section_set(&fw->section[RTW_FW_SECTION_IMEM], cur_fw,
+		       le32_to_cpu(fw_hdr->imem_addr) & ~BIT(31), imem_size);
+	cur_fw += imem_size;
+	fw_section_set(&fw->section[RTW_FW_SECTION_EMEM], cur_fw,
+		       le32_to_cpu(fw_hdr->emem_addr) & ~BIT(31), emem_size);
+	fw->section_num = emem_size ? RTW_FW_SECTION_EMEM + 1 :
+				      RTW_FW_SECTION_IMEM + 1;
+
+	_update_firmware_info(rtwdev, fw);
+
+	return 0;
+}
+
+static int _parse_firmware_legacy(struct rtw_dev *rtwdev,
+				  struct rtw_fw_state *fw)
+{
+	u32 hdr_size = sizeof(struct rtw_fw_hdr_legacy);
+
+	if (fw->firmware->size <= hdr_size)
+		return -EINVAL;
+
+	/* the whole image goes through the page window */
+	fw_section_set(&fw->section[0], fw->firmware->data + hdr_size,
+		       FW_START_ADDR_LEGACY, fw->firmware->size - hdr_size);
+	fw->section_num = 1;
+
+	_update_firmware_info_legacy(rtwdev, fw);
+
+	return 0;
+}
+
+/* Parse the image once when it is loaded, the header fields and the
+ * section layout are kept in fw and reused by every download.
+ */
+int rtw_parse_firmware(struct rtw_dev *rtwdev, struct rtw_fw_state *fw)
+{
+	int ret;
+
 	if (rtwdev->chip->wlan_cpu == RTW_WCPU_11N)
-		_update_firmware_info_legacy(rtwdev, fw);
+		ret = _parse_firmware_legacy(rtwdev, fw);
 	else
-		_update_firmware_info(rtwdev, fw);
+		ret = _parse_firmware(rtwdev, fw);
+	if (ret) {
+		rtw_err(rtwdev, "invalid firmware image\n");
+		return ret;
+	}
 
 	rtw_dbg(rtwdev, RTW_DBG_FW, "fw h2c version: %x\n", fw->h2c_version);
 	rtw_dbg(rtwdev, RTW_DBG_FW, "fw version:     %x\n", fw->version);
 	rtw_dbg(rtwdev, RTW_DBG_FW, "fw sub version: %x\n", fw->sub_version);
 	rtw_dbg(rtwdev, RTW_DBG_FW, "fw sub index:   %x\n", fw->sub_index);
+
+	return 0;
 }
 
 static int
-start_download_firmware(struct rtw_dev *rtwdev, const u8 *data, u32 size)
+start_download_firmware(struct rtw_dev *rtwdev, struct rtw_fw_state *fw)
 {
-	const struct rtw_fw_hdr *fw_hdr = (const struct rtw_fw_hdr *)data;
-	const u8 *cur_fw;
+	struct rtw_fw_section *section;
 	u16 val;
-	u32 imem_size;
-	u32 dmem_size;
-	u32 emem_size;
-	u32 addr;
 	int ret;
-
-	dmem_size = le32_to_cpu(fw_hdr->dmem_size);
-	imem_size = le32_to_cpu(fw_hdr->imem_size);
-	emem_size = (fw_hdr->mem_usage & BIT(4)) ?
-		    le32_to_cpu(fw_hdr->emem_size) : 0;
-	dmem_size += FW_HDR_CHKSUM_SIZE;
-	imem_size += FW_HDR_CHKSUM_SIZE;
-	emem_size += emem_size ? FW_HDR_CHKSUM_SIZE : 0;
+	u8 i;
 
 	val = (u16)(rtw_read16(rtwdev, REG_MCUFW_CTRL) & 0x3800);
 	val |= BIT_MCUFWDL_EN;
 	rtw_write16(rtwdev, REG_MCUFW_CTRL, val);
 
-	cur_fw = data + FW_HDR_SIZE;
-	addr = le32_to_cpu(fw_hdr->dmem_addr);
-	addr &= ~BIT(31);
-	ret = download_firmware_to_mem(rtwdev, cur_fw, 0, addr, dmem_size);
-	if (ret)
-		return ret;
-
-	cur_fw = data + FW_HDR_SIZE + dmem_size;
-	addr = le32_to_cpu(fw_hdr->imem_addr);
-	addr &= ~BIT(31);
-	ret = download_firmware_to_mem(rtwdev, cur_fw, 0, addr, imem_size);
-	if (ret)
-		return ret;
-
-	if (emem_size) {
-		cur_fw = data + FW_HDR_SIZE + dmem_size + imem_size;
-		addr = le32_to_cpu(fw_hdr->emem_addr);
-		addr &= ~BIT(31);
-		ret = download_firmware_to_mem(rtwdev, cur_fw, 0, addr,
-					       emem_size);
+	for (i = 0; i < fw->section_num; i++) {
+		section = &fw->section[i];
+		ret = download_firmware_to_mem(rtwdev, fw, section->data, 0,
+					       section->addr, section->size);
 		if (ret)
 			return ret;
 	}
@@ -698,7 +893,7 @@ static int download_firmware_validate(struct rtw_dev *rtwdev)
 {
 	u32 fw_key;
 
-	if (!check_hw_ready(rtwdev, REG_MCUFW_CTRL, FW_READY_MASK, FW_READY)) {
+	if (rtw_poll32(rtwdev, REG_MCUFW_CTRL, FW_READY_MASK, FW_READY)) {
 		fw_key = rtw_read32(rtwdev, REG_FW_DBG7) & FW_KEY_MASK;
 		if (fw_key == ILLEGAL_KEY_GROUP)
 			rtw_err(rtwdev, "invalid fw key\n");
@@ -726,13 +921,17 @@ static void download_firmware_end_flow(struct rtw_dev *rtwdev)
 int _rtw_download_firmware(struct rtw_dev *rtwdev, struct rtw_fw_state *fw)
 {
 	struct rtw_backup_info bckp[DLFW_RESTORE_REG_NUM];
-	const u8 *data = fw->firmware->data;
-	u32 size = fw->firmware->size;
 	u32 ltecoex_bckp;
+	ktime_t start = ktime_get();
+	ktime_t validate;
 	int ret;
 
-	if (!check_firmware_size(data, size))
-		return -EINVAL;
+	fw->dl_txbuf_us = 0;
+	fw->dl_ddma_us = 0;
+
+	/* firmware is downloaded through the tx buffer */
+	rtw_fw_rsvd_page_cache_invalidate(rtwdev);
+	rtw_rf_shadow_invalidate(rtwdev);
 
 	if (!ltecoex_read_reg(rtwdev, 0x38, &ltecoex_bckp))
 		return -EBUSY;
@@ -742,7 +941,7 @@ int _rtw_download_firmware(struct rtw_dev *rtwdev, struct rtw_fw_state *fw)
 	download_firmware_reg_backup(rtwdev, bckp);
 	download_firmware_reset_platform(rtwdev);
 
-	ret = start_download_firmware(rtwdev, data, size);
+	ret = start_download_firmware(rtwdev, fw);
 	if (ret)
 		goto dlfw_fail;
 
@@ -755,11 +954,13 @@ int _rtw_download_firmware(struct rtw_dev *rtwdev, struct rtw_fw_state *fw)
 	if (!ltecoex_reg_write(rtwdev, 0x38, ltecoex_bckp))
 		return -EBUSY;
 
+	validate = ktime_get();
 	ret = download_firmware_validate(rtwdev);
 	if (ret)
 		goto dlfw_fail;
 
-	update_firmware_info(rtwdev, fw);
+	fw->dl_validate_us = ktime_us_delta(ktime_get(), validate);
+	rtw_fw_dl_time_update(rtwdev, fw, start);
 
 	/* reset desc and index */
 	rtw_hci_setup(rtwdev);
@@ -814,7 +1015,6 @@ write_firmware_page(struct rtw_dev *rtwdev, u32 page, const u8 *data, u32 size)
 	u32 remain_size;
 	u32 write_addr = FW_START_ADDR_LEGACY;
 	const __le32 *ptr = (const __le32 *)data;
-	u32 block;
 	u8 remain_data[4] = {0};
 
 	block_nr = size / DLFW_BLK_SIZE_LEGACY;
@@ -825,12 +1025,9 @@ write_firmware_page(struct rtw_dev *rtwdev, u32 page, const u8 *data, u32 size)
 	val32 |= (page << BIT_SHIFT_ROM_PGE) & BIT_ROM_PGE;
 	rtw_write32(rtwdev, REG_MCUFW_CTRL, val32);
 
-	for (block = 0; block < block_nr; block++) {
-		rtw_write32(rtwdev, write_addr, le32_to_cpu(*ptr));
-
-		write_addr += DLFW_BLK_SIZE_LEGACY;
-		ptr++;
-	}
+	rtw_write_block32(rtwdev, write_addr, ptr, block_nr);
+	write_addr += block_nr * DLFW_BLK_SIZE_LEGACY;
+	ptr += block_nr;
 
 	data = (const u8 *)ptr;
 	switch (remain_size) {
@@ -854,9 +1051,6 @@ int download_firmware_legacy(struct rtw_dev *rtwdev, const u8 *data, u32 size)
 	u32 total_page;
 	u32 last_page_size;
 
-	data += sizeof(struct rtw_fw_hdr_legacy);
-	size -= sizeof(struct rtw_fw_hdr_legacy);
-
 	total_page = size / DLFW_PAGE_SIZE_LEGACY;
 	last_page_size = size & (DLFW_PAGE_SIZE_LEGACY - 1);
 
@@ -869,7 +1063,7 @@ int download_firmware_legacy(struct rtw_dev *rtwdev, const u8 *data, u32 size)
 	if (last_page_size)
 		write_firmware_page(rtwdev, page, data, last_page_size);
 
-	if (!check_hw_ready(rtwdev, REG_MCUFW_CTRL, BIT_FWDL_CHK_RPT, 1)) {
+	if (rtw_poll32(rtwdev, REG_MCUFW_CTRL, BIT_FWDL_CHK_RPT, 1)) {
 		rtw_err(rtwdev, "Download fimrware check report failed\n");
 		return -EINVAL;
 	}
@@ -903,19 +1097,30 @@ static int download_firmware_validate_legacy(struct rtw_dev *rtwdev)
 
 int _rtw_download_firmware_legacy(struct rtw_dev *rtwdev, struct rtw_fw_state *fw)
 {
+	ktime_t start = ktime_get();
+	ktime_t validate;
 	int ret = 0;
 
+	rtw_fw_rsvd_page_cache_invalidate(rtwdev);
+	rtw_rf_shadow_invalidate(rtwdev);
+
 	en_download_firmware_legacy(rtwdev, true);
-	ret = download_firmware_legacy(rtwdev, fw->firmware->data, fw->firmware->size);
+	ret = download_firmware_legacy(rtwdev, fw->section[0].data,
+				       fw->section[0].size);
 	en_download_firmware_legacy(rtwdev, false);
 	if (ret)
 		goto out;
 
+	validate = ktime_get();
+	fw->dl_txbuf_us = ktime_us_delta(validate, start);
+	fw->dl_ddma_us = 0;
+
 	ret = download_firmware_validate_legacy(rtwdev);
 	if (ret)
 		goto out;
 
-	update_firmware_info(rtwdev, fw);
+	fw->dl_validate_us = ktime_us_delta(ktime_get(), validate);
+	rtw_fw_dl_time_update(rtwdev, fw, start);
 
 	/* reset desc and index */
 	rtw_hci_setup(rtwdev);
@@ -946,32 +1151,45 @@ static u32 get_priority_queues(struct rtw_dev *rtwdev, u32 queues)
 	return prio_queues;
 }
 
-static void __rtw_mac_flush_prio_queue(struct rtw_dev *rtwdev,
-				       u32 prio_queue, bool drop)
+static bool rtw_mac_prio_queue_empty(struct rtw_dev *rtwdev,
+				     struct rtw_prioq_addr *addr, bool wsize)
+{
+	u16 avail_page, rsvd_page;
+
+	rsvd_page = wsize ? rtw_read16(rtwdev, addr->rsvd) :
+			     rtw_read8(rtwdev, addr->rsvd);
+	avail_page = wsize ? rtw_read16(rtwdev, addr->avail) :
+			      rtw_read8(rtwdev, addr->avail);
+
+	return rsvd_page == avail_page;
+}
+
+static int __rtw_mac_flush_prio_queue(struct rtw_dev *rtwdev,
+				      u32 prio_queue, bool drop)
 {
 	struct rtw_chip_info *chip = rtwdev->chip;
 	struct rtw_prioq_addr *addr;
 	bool wsize;
-	u16 avail_page, rsvd_page;
-	int i;
+	bool empty;
+	int ret;
 
 	if (prio_queue >= RTW_DMA_MAPPING_MAX)
-		return;
+		return 0;
 
 	addr = &chip->prioq_addrs->prio[prio_queue];
 	wsize = chip->prioq_addrs->wsize;
 
-	/* check if all of the reserved pages are available for 100 msecs */
-	for (i = 0; i < 5; i++) {
-		rsvd_page = wsize ? rtw_read16(rtwdev, addr->rsvd) :
-				     rtw_read8(rtwdev, addr->rsvd);
-		avail_page = wsize ? rtw_read16(rtwdev, addr->avail) :
-				      rtw_read8(rtwdev, addr->avail);
-		if (rsvd_page == avail_page)
-			return;
-
-		msleep(20);
-	}
+	/* host rings are drained already when not dropping, so only the
+	 * frames in MAC are left, check if all of the reserved pages are
+	 * available within 100 msecs
+	 */
+	if (drop)
+		ret = rtw_mac_prio_queue_empty(rtwdev, addr, wsize) ? 0 : -EBUSY;
+	else
+		ret = read_poll_timeout(rtw_mac_prio_queue_empty, empty, empty,
+					1000, 100000, false, rtwdev, addr, wsize);
+	if (!ret)
+		return 0;
 
 	/* priority queue is still not empty, throw a warning,
 	 *
@@ -981,19 +1199,25 @@ static void __rtw_mac_flush_prio_queue(struct rtw_dev *rtwdev,
 	 */
 	if (!drop)
 		rtw_warn(rtwdev, "timed out to flush queue %d\n", prio_queue);
+
+	return -ETIMEDOUT;
 }
 
-static void rtw_mac_flush_prio_queues(struct rtw_dev *rtwdev,
-				      u32 prio_queues, bool drop)
+static int rtw_mac_flush_prio_queues(struct rtw_dev *rtwdev,
+				     u32 prio_queues, bool drop)
 {
+	int ret = 0;
 	u32 q;
 
 	for (q = 0; q < RTW_DMA_MAPPING_MAX; q++)
-		if (prio_queues & BIT(q))
-			__rtw_mac_flush_prio_queue(rtwdev, q, drop);
+		if (prio_queues & BIT(q) &&
+		    __rtw_mac_flush_prio_queue(rtwdev, q, drop))
+			ret = -ETIMEDOUT;
+
+	return ret;
 }
 
-void rtw_mac_flush_queues(struct rtw_dev *rtwdev, u32 queues, bool drop)
+int rtw_mac_flush_queues(struct rtw_dev *rtwdev, u32 queues, bool drop)
 {
 	u32 prio_queues = 0;
 
@@ -1006,7 +1230,7 @@ void rtw_mac_flush_queues(struct rtw_dev *rtwdev, u32 queues, bool drop)
 	else
 		prio_queues = get_priority_queues(rtwdev, queues);
 
-	rtw_mac_flush_prio_queues(rtwdev, prio_queues, drop);
+	return rtw_mac_flush_prio_queues(rtwdev, prio_queues, drop);
 }
 
 static int txdma_queue_mapping(struct rtw_dev *rtwdev)
@@ -1176,7 +1400,7 @@ int _priority_queue_cfg(struct rtw_dev *rtwdev, struct rtw_page_table *pg_tbl,
 	rtw_write32(rtwdev, REG_RXFF_BNDY, chip->rxff_size - C2H_PKT_BUF - 1);
 	rtw_write8_set(rtwdev, REG_AUTO_LLT_V1, BIT_AUTO_INIT_LLT_V1);
 
-	if (!check_hw_ready(rtwdev, REG_AUTO_LLT_V1, BIT_AUTO_INIT_LLT_V1, 0))
+	if (rtw_poll32(rtwdev, REG_AUTO_LLT_V1, BIT_AUTO_INIT_LLT_V1, 0))
 		return -EBUSY;
 
 	rtw_write8(rtwdev, REG_CR + 3, 0);
@@ -1208,7 +1432,7 @@ int _priority_queue_cfg_legacy(struct rtw_dev *rtwdev,
 	val32 |= BIT_AUTO_INIT_LLT;
 	rtw_write32(rtwdev, REG_AUTO_LLT, val32);
 
-	if (!check_hw_ready(rtwdev, REG_AUTO_LLT, BIT_AUTO_INIT_LLT, 0))
+	if (rtw_poll32(rtwdev, REG_AUTO_LLT, BIT_AUTO_INIT_LLT, 0))
 		return -EBUSY;
 
 	return 0;
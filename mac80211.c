@@ -279,8 +279,11 @@ static void rtw_ops_bss_info_changed(struct ieee80211_hw *hw,
 		if (conf->assoc) {
 			rtw_coex_connect_notify(rtwdev, COEX_ASSOCIATE_FINISH);
 			net_type = RTW_NET_MGD_LINKED;
-			if (!rtw_chip_wcpu_11n(rtwdev))
+			if (!rtw_chip_wcpu_11n(rtwdev)) {
+				mutex_lock(&rtwdev->dm_mutex);
 				chip->ops->phy_calibration(rtwdev);
+				mutex_unlock(&rtwdev->dm_mutex);
+			}
 
 			rtwvif->aid = conf->aid;
 			rtw_fw_config_rsvd_page(rtwdev);
@@ -291,6 +294,8 @@ static void rtw_ops_bss_info_changed(struct ieee80211_hw *hw,
 				rtw_bf_assoc(rtwdev, vif, conf);
 
 			rtwdev->fix_rate_count = 20;
+			rtw_boot_time_mark(rtwdev,
+					   &rtwdev->boot_time.first_link);
 		} else {
 			rtw_leave_lps(rtwdev);
 			net_type = RTW_NET_NO_LINK;
@@ -534,8 +539,10 @@ static void rtw_ops_sw_scan_start(struct ieee80211_hw *hw,
 
 	rtw_coex_scan_notify(rtwdev, COEX_SCAN_START);
 
+	mutex_lock(&rtwdev->dm_mutex);
 	set_bit(RTW_FLAG_DIG_DISABLE, rtwdev->flags);
 	set_bit(RTW_FLAG_SCANNING, rtwdev->flags);
+	mutex_unlock(&rtwdev->dm_mutex);
 
 	mutex_unlock(&rtwdev->mutex);
 }
@@ -566,10 +573,21 @@ static void rtw_ops_mgd_prepare_tx(struct ieee80211_hw *hw,
 				   u16 duration)
 {
 	struct rtw_dev *rtwdev = hw->priv;
+	struct rtw_chip_info *chip = rtwdev->chip;
 
 	mutex_lock(&rtwdev->mutex);
 	rtw_leave_lps_deep(rtwdev);
 	rtw_coex_connect_notify(rtwdev, COEX_ASSOCIATE_START);
+
+	/* driver IQK of 11N chip, set by rtw_set_channel(), is done here
+	 * instead of the tx path, so that the DM engine is kept off the BB
+	 */
+	if (rtwdev->need_rfk) {
+		rtwdev->need_rfk = false;
+		mutex_lock(&rtwdev->dm_mutex);
+		chip->ops->phy_calibration(rtwdev);
+		mutex_unlock(&rtwdev->dm_mutex);
+	}
 	mutex_unlock(&rtwdev->mutex);
 }
 
@@ -589,9 +607,13 @@ static void rtw_ops_sta_statistics(struct ieee80211_hw *hw,
 				   struct ieee80211_sta *sta,
 				   struct station_info *sinfo)
 {
+	struct rtw_dev *rtwdev = hw->priv;
 	struct rtw_sta_info *si = (struct rtw_sta_info *)sta->drv_priv;
+	unsigned long flags;
 
+	spin_lock_irqsave(&rtwdev->dm_lock, flags);
 	sinfo->txrate = si->ra_report.txrate;
+	spin_unlock_irqrestore(&rtwdev->dm_lock, flags);
 	sinfo->filled |= BIT_ULL(NL80211_STA_INFO_TX_BITRATE);
 }
 
@@ -600,11 +622,28 @@ static void rtw_ops_flush(struct ieee80211_hw *hw,
 			  u32 queues, bool drop)
 {
 	struct rtw_dev *rtwdev = hw->priv;
+	struct rtw_flush_stats *stats = &rtwdev->flush_stats;
+	ktime_t start = ktime_get();
+	u32 time_us;
+	int ret;
 
 	mutex_lock(&rtwdev->mutex);
 	rtw_leave_lps_deep(rtwdev);
 
-	rtw_mac_flush_queues(rtwdev, queues, drop);
+	/* wait for host rings first, MAC pages are checked at the end */
+	ret = rtw_hci_flush_queues(rtwdev, queues, drop);
+	if (rtw_mac_flush_queues(rtwdev, queues, drop))
+		ret = -ETIMEDOUT;
+
+	time_us = ktime_us_delta(ktime_get(), start);
+	stats->cnt++;
+	if (drop)
+		stats->drop_cnt++;
+	if (ret)
+		stats->timeout_cnt++;
+	stats->last_us = time_us;
+	stats->max_us = max(stats->max_us, time_us);
+	stats->total_us += time_us;
 	mutex_unlock(&rtwdev->mutex);
 }
 
@@ -20,7 +20,11 @@
 
 unsigned int rtw_fw_lps_deep_mode = LPS_DEEP_MODE_LCLK;
 EXPORT_SYMBOL(rtw_fw_lps_deep_mode);
-static bool rtw_fw_support_lps = true;
+bool rtw_fw_support_lps = true;
+unsigned int rtw_lps_idle_gap_ms = RTW_LPS_IDLE_GAP_MS;
+unsigned int rtw_ips_mode = RTW_IPS_MODE_PWR_OFF;
+bool rtw_phy_tbl_precompile = true;
+unsigned int rtw_dm_period_ms = RTW_DM_PERIOD_MS;
 bool rtw_bf_support = true;
 unsigned int rtw_debug_mask;
 EXPORT_SYMBOL(rtw_debug_mask);
@@ -28,12 +32,20 @@ bool rtw_allow_user_reg_set;
 
 module_param_named(lps_deep_mode, rtw_fw_lps_deep_mode, uint, 0444);
 module_param_named(support_lps, rtw_fw_support_lps, bool, 0644);
+module_param_named(lps_idle_gap, rtw_lps_idle_gap_ms, uint, 0644);
+module_param_named(ips_mode, rtw_ips_mode, uint, 0644);
+module_param_named(phy_tbl_precompile, rtw_phy_tbl_precompile, bool, 0644);
+module_param_named(dm_period, rtw_dm_period_ms, uint, 0644);
 module_param_named(support_bf, rtw_bf_support, bool, 0644);
 module_param_named(debug_mask, rtw_debug_mask, uint, 0644);
 module_param_named(allow_user_reg_set, rtw_allow_user_reg_set, bool, 0644);
 
 MODULE_PARM_DESC(lps_deep_mode, "Deeper PS mode. If 0, deep PS is disabled");
 MODULE_PARM_DESC(support_lps, "Set Y to enable Leisure Power Save support, to turn radio off between beacons");
+MODULE_PARM_DESC(lps_idle_gap, "Idle time in ms before entering LPS without waiting for watchdog. If 0, only watchdog enters LPS");
+MODULE_PARM_DESC(phy_tbl_precompile, "Set Y to load PHY tables resolved once at probe instead of parsing them on every power on");
+MODULE_PARM_DESC(ips_mode, "Idle PS mode. 0: power off the card, 1: keep MAC and firmware powered with baseband off for faster leave");
+MODULE_PARM_DESC(dm_period, "Period in ms of DIG and CCK PD under traffic, backed off to 2s when idle. If 0, they run from watchdog only");
 MODULE_PARM_DESC(support_bf, "Set Y to enable beamformee support");
 MODULE_PARM_DESC(debug_mask, "Debugging mask");
 MODULE_PARM_DESC(allow_user_reg_set, "Set Y to allow regulatory settings from user");
@@ -381,11 +393,68 @@ void rtw_get_channel_params(struct cfg80211_chan_def *chandef,
 		cch_by_bw[i] = 0;
 }
 
+static void __rtw_set_channel_stage(struct rtw_chsw_stats *stats,
+				    enum rtw_chsw_stage stage, ktime_t from,
+				    ktime_t to)
+{
+	u32 us = ktime_us_delta(to, from);
+	u32 idx = min_t(u32, fls(us), RTW_CHSW_HIST_NUM - 1);
+
+	stats->hist[stage][idx]++;
+	stats->cnt[stage]++;
+	stats->max_us[stage] = max(stats->max_us[stage], us);
+	stats->total_us[stage] += us;
+}
+
+/* account the time since the previous stage of rtw_set_channel() to stage,
+ * chip set_channel ops call it after each of their steps
+ */
+void rtw_set_channel_stage(struct rtw_dev *rtwdev, enum rtw_chsw_stage stage)
+{
+	struct rtw_chsw_stats *stats = &rtwdev->hal.chsw_stats;
+	ktime_t now = ktime_get();
+
+	__rtw_set_channel_stage(stats, stage, stats->last, now);
+	stats->last = now;
+}
+
+/* MAC and BB have been reset or reloaded */
+void rtw_set_channel_invalidate(struct rtw_dev *rtwdev)
+{
+	rtwdev->hal.chsw.valid = false;
+}
+
+static u8 rtw_set_channel_band_class(u8 channel)
+{
+	/* channel 14 has its own CCK filter */
+	if (channel == 14)
+		return 2;
+
+	return channel > 14 ? 1 : 0;
+}
+
+static void rtw_set_channel_check_bw(struct rtw_dev *rtwdev, u8 channel,
+				     u8 bw, u8 primary_chan_idx)
+{
+	struct rtw_chsw_state *chsw = &rtwdev->hal.chsw;
+	u8 band_class = rtw_set_channel_band_class(channel);
+
+	chsw->bw_unchanged = chsw->valid &&
+			     chsw->band_class == band_class &&
+			     chsw->bw == bw &&
+			     chsw->primary_chan_idx == primary_chan_idx;
+
+	chsw->band_class = band_class;
+	chsw->bw = bw;
+	chsw->primary_chan_idx = primary_chan_idx;
+}
+
 void rtw_set_channel(struct rtw_dev *rtwdev)
 {
 	struct ieee80211_hw *hw = rtwdev->hw;
 	struct rtw_hal *hal = &rtwdev->hal;
 	struct rtw_chip_info *chip = rtwdev->chip;
+	struct rtw_chsw_stats *stats = &hal->chsw_stats;
 	struct rtw_channel_params ch_param;
 	u8 center_chan, bandwidth, primary_chan_idx;
 	u8 i;
@@ -394,6 +463,9 @@ void rtw_set_channel(struct rtw_dev *rtwdev)
 	if (WARN(ch_param.center_chan == 0, "Invalid channel\n"))
 		return;
 
+	stats->start = ktime_get();
+	stats->last = stats->start;
+
 	center_chan = ch_param.center_chan;
 	bandwidth = ch_param.bandwidth;
 	primary_chan_idx = ch_param.primary_chan_idx;
@@ -405,7 +477,16 @@ void rtw_set_channel(struct rtw_dev *rtwdev)
 	for (i = RTW_CHANNEL_WIDTH_20; i <= RTW_MAX_CHANNEL_WIDTH; i++)
 		hal->cch_by_bw[i] = ch_param.cch_by_bw[i];
 
+	/* keep dm engine off the BB while it is reconfigured */
+	mutex_lock(&rtwdev->dm_mutex);
+	rtw_set_channel_check_bw(rtwdev, center_chan, bandwidth,
+				 primary_chan_idx);
+	if (hal->chsw.bw_unchanged)
+		stats->fast_cnt++;
+
 	chip->ops->set_channel(rtwdev, center_chan, bandwidth, primary_chan_idx);
+	hal->chsw.valid = true;
+	rtw_set_channel_stage(rtwdev, RTW_CHSW_CHIP);
 
 	if (hal->current_band_type == RTW_BAND_5G) {
 		rtw_coex_switchband_notify(rtwdev, COEX_SWITCH_TO_5G);
@@ -415,8 +496,14 @@ void rtw_set_channel(struct rtw_dev *rtwdev)
 		else
 			rtw_coex_switchband_notify(rtwdev, COEX_SWITCH_TO_24G_NOFORSCAN);
 	}
+	rtw_set_channel_stage(rtwdev, RTW_CHSW_COEX);
 
 	rtw_phy_set_tx_power_level(rtwdev, center_chan);
+	rtw_set_channel_stage(rtwdev, RTW_CHSW_TXPWR);
+	mutex_unlock(&rtwdev->dm_mutex);
+
+	__rtw_set_channel_stage(stats, RTW_CHSW_TOTAL, stats->start,
+				stats->last);
 
 	/* 11N chip uses driver IQK that takes lot of time, so move here
 	 * to avoid interferencing 4 way handshake.
@@ -889,12 +976,69 @@ int rtw_core_start(struct rtw_dev *rtwdev)
 				     RTW_WATCH_DOG_DELAY_TIME);
 	ieee80211_queue_delayed_work(rtwdev->hw, &rtwdev->sar_work,
 				     RTW_SAR_DELAY_TIME);
+	rtw_phy_dm_engine_start(rtwdev);
 
 	set_bit(RTW_FLAG_RUNNING, rtwdev->flags);
 
+	rtw_boot_time_mark(rtwdev, &rtwdev->boot_time.first_start);
+
 	return 0;
 }
 
+/* Stop TX/RX and hold baseband in reset, but keep MAC and firmware powered
+ * so that rtw_core_bb_on() does not need to reload anything.
+ */
+void rtw_core_bb_off(struct rtw_dev *rtwdev)
+{
+	struct rtw_coex *coex = &rtwdev->coex;
+	struct rtw_tx_report *tx_report = &rtwdev->tx_report;
+	unsigned long flags;
+
+	clear_bit(RTW_FLAG_RUNNING, rtwdev->flags);
+
+	cancel_delayed_work_sync(&rtwdev->watch_dog_work);
+	cancel_delayed_work_sync(&rtwdev->sar_work);
+	rtw_phy_dm_engine_stop(rtwdev);
+	rtw_lps_ctrl_stop(rtwdev);
+	cancel_delayed_work_sync(&coex->bt_relink_work);
+	cancel_delayed_work_sync(&coex->bt_reenable_work);
+	cancel_delayed_work_sync(&coex->defreeze_work);
+
+	/* firmware is still running, give queued H2C a chance to reach it */
+	if (!rtw_fw_h2c_queue_flush(rtwdev))
+		rtw_dbg(rtwdev, RTW_DBG_FW, "drop H2C queued before BB off\n");
+	rtw_fw_h2c_queue_purge(rtwdev);
+
+	/* no tx report comes back while tx is paused and BB is in reset */
+	del_timer_sync(&tx_report->purge_timer);
+	spin_lock_irqsave(&tx_report->q_lock, flags);
+	skb_queue_purge(&tx_report->queue);
+	spin_unlock_irqrestore(&tx_report->q_lock, flags);
+
+	rtwdev->ips.txpause = rtw_read8(rtwdev, REG_TXPAUSE);
+	rtw_write8(rtwdev, REG_TXPAUSE, 0xff);
+	rtw_write8_clr(rtwdev, REG_SYS_FUNC_EN, BIT_FEN_BB_RSTB);
+	rtwdev->ips.bb_off = true;
+}
+
+void rtw_core_bb_on(struct rtw_dev *rtwdev)
+{
+	rtw_write8_set(rtwdev, REG_SYS_FUNC_EN, BIT_FEN_BB_RSTB);
+	rtw_write8(rtwdev, REG_TXPAUSE, rtwdev->ips.txpause);
+	rtw_phy_txagc_invalidate(rtwdev);
+	rtw_set_channel_invalidate(rtwdev);
+	rtw_phy_pwrtrack_invalidate(rtwdev);
+	rtwdev->ips.bb_off = false;
+
+	ieee80211_queue_delayed_work(rtwdev->hw, &rtwdev->watch_dog_work,
+				     RTW_WATCH_DOG_DELAY_TIME);
+	ieee80211_queue_delayed_work(rtwdev->hw, &rtwdev->sar_work,
+				     RTW_SAR_DELAY_TIME);
+	rtw_phy_dm_engine_start(rtwdev);
+
+	set_bit(RTW_FLAG_RUNNING, rtwdev->flags);
+}
+
 static void rtw_power_off(struct rtw_dev *rtwdev)
 {
 	rtwdev->hci.ops->stop(rtwdev);
@@ -910,11 +1054,15 @@ void rtw_core_stop(struct rtw_dev *rtwdev)
 
 	cancel_delayed_work_sync(&rtwdev->watch_dog_work);
 	cancel_delayed_work_sync(&rtwdev->sar_work);
+	rtw_phy_dm_engine_stop(rtwdev);
+	rtw_lps_ctrl_stop(rtwdev);
 	cancel_delayed_work_sync(&coex->bt_relink_work);
 	cancel_delayed_work_sync(&coex->bt_reenable_work);
 	cancel_delayed_work_sync(&coex->defreeze_work);
+	rtw_fw_h2c_queue_purge(rtwdev);
 
 	rtw_power_off(rtwdev);
+	rtwdev->ips.bb_off = false;
 }
 
 static void rtw_init_ht_cap(struct rtw_dev *rtwdev,
@@ -1039,8 +1187,15 @@ static void rtw_unset_supported_band(struct ieee80211_hw *hw,
 static void rtw_load_firmware_cb(const struct firmware *firmware, void *context)
 {
 	struct rtw_fw_state *fw = context;
+	struct rtw_dev *rtwdev = fw->rtwdev;
 
 	fw->firmware = firmware;
+	if (firmware && rtw_parse_firmware(rtwdev, fw)) {
+		release_firmware(firmware);
+		fw->firmware = NULL;
+	}
+
+	rtw_boot_time_mark(rtwdev, &rtwdev->boot_time.fw_loaded);
 	complete_all(&fw->completion);
 }
 
@@ -1066,6 +1221,7 @@ static int rtw_load_firmware(struct rtw_dev *rtwdev, enum rtw_fw_type type)
 		return -ENOENT;
 	}
 
+	fw->rtwdev = rtwdev;
 	init_completion(&fw->completion);
 
 	ret = request_firmware_nowait(THIS_MODULE, true, fw_name, rtwdev->dev,
@@ -1130,7 +1286,6 @@ static int rtw_chip_parameter_setup(struct rtw_dev *rtwdev)
 
 static int rtw_chip_efuse_enable(struct rtw_dev *rtwdev)
 {
-	struct rtw_fw_state *fw = &rtwdev->fw;
 	int ret;
 
 	ret = rtw_hci_setup(rtwdev);
@@ -1147,26 +1302,30 @@ static int rtw_chip_efuse_enable(struct rtw_dev *rtwdev)
 
 	rtw_write8(rtwdev, REG_C2HEVT, C2H_HW_FEATURE_DUMP);
 
+	return 0;
+
+err:
+	return ret;
+}
+
+static int rtw_chip_efuse_download_fw(struct rtw_dev *rtwdev)
+{
+	struct rtw_fw_state *fw = &rtwdev->fw;
+	int ret;
+
 	wait_for_completion(&fw->completion);
 	if (!fw->firmware) {
-		ret = -EINVAL;
 		rtw_err(rtwdev, "failed to load firmware\n");
-		goto err;
+		return -EINVAL;
 	}
 
 	ret = rtw_download_firmware(rtwdev, fw);
 	if (ret) {
 		rtw_err(rtwdev, "failed to download firmware\n");
-		goto err_off;
+		return ret;
 	}
 
 	return 0;
-
-err_off:
-	rtw_mac_power_off(rtwdev);
-
-err:
-	return ret;
 }
 
 static int rtw_dump_hw_feature(struct rtw_dev *rtwdev)
@@ -1227,10 +1386,15 @@ static int rtw_chip_efuse_info_setup(struct rtw_dev *rtwdev)
 	if (ret)
 		goto out_unlock;
 
+	/* efuse is parsed while the firmware is still being loaded */
 	ret = rtw_parse_efuse_map(rtwdev);
 	if (ret)
 		goto out_disable;
 
+	ret = rtw_chip_efuse_download_fw(rtwdev);
+	if (ret)
+		goto out_disable;
+
 	ret = rtw_dump_hw_feature(rtwdev);
 	if (ret)
 		goto out_disable;
@@ -1281,6 +1445,7 @@ static int rtw_chip_board_info_setup(struct rtw_dev *rtwdev)
 		return -ENODEV;
 
 	rtw_phy_setup_phy_cond(rtwdev, 0);
+	rtw_phy_compile_tables(rtwdev);
 
 	rtw_phy_init_tx_power(rtwdev);
 	rtw_load_table(rtwdev, rfe_def->phy_pg_tbl);
@@ -1314,6 +1479,8 @@ int rtw_chip_info_setup(struct rtw_dev *rtwdev)
 		goto err_out;
 	}
 
+	rtw_boot_time_mark(rtwdev, &rtwdev->boot_time.chip_setup);
+
 	return 0;
 
 err_out:
@@ -1342,6 +1509,19 @@ int rtw_core_init(struct rtw_dev *rtwdev)
 	struct rtw_coex *coex = &rtwdev->coex;
 	int ret;
 
+	rtwdev->boot_time.probe = ktime_get();
+	spin_lock_init(&rtwdev->poll_stats.lock);
+	rtw_phy_db_tbl_init();
+
+	rtwdev->rx_hist = vzalloc(sizeof(*rtwdev->rx_hist));
+	if (!rtwdev->rx_hist)
+		return -ENOMEM;
+
+	rtwdev->rx_hist->version = RTW_RX_HIST_VERSION;
+	rtwdev->rx_hist->mac_id_num = RTW_MAX_MAC_ID_NUM;
+	rtwdev->rx_hist->rate_num = DESC_RATE_MAX;
+	rtwdev->rx_hist->ring_occ_num = RTW_RX_RING_OCC_NUM;
+
 	INIT_LIST_HEAD(&rtwdev->rsvd_page_list);
 	INIT_LIST_HEAD(&rtwdev->txqs);
 
@@ -1350,7 +1530,10 @@ int rtw_core_init(struct rtw_dev *rtwdev)
 
 	INIT_DELAYED_WORK(&rtwdev->watch_dog_work, rtw_watch_dog_work);
 	INIT_DELAYED_WORK(&rtwdev->lps_work, rtw_lps_work);
+	rtw_lps_ctrl_init(rtwdev);
 	INIT_DELAYED_WORK(&rtwdev->sar_work, rtw_sar_work);
+	rtw_phy_dm_engine_init(rtwdev);
+	INIT_DELAYED_WORK(&rtwdev->h2c.work, rtw_fw_h2c_work);
 	INIT_DELAYED_WORK(&coex->bt_relink_work, rtw_coex_bt_relink_work);
 	INIT_DELAYED_WORK(&coex->bt_reenable_work, rtw_coex_bt_reenable_work);
 	INIT_DELAYED_WORK(&coex->defreeze_work, rtw_coex_defreeze_work);
@@ -1361,7 +1544,9 @@ int rtw_core_init(struct rtw_dev *rtwdev)
 	skb_queue_head_init(&rtwdev->tx_report.queue);
 
 	spin_lock_init(&rtwdev->dm_lock);
+	mutex_init(&rtwdev->dm_mutex);
 	spin_lock_init(&rtwdev->rf_lock);
+	rtw_rf_shadow_init(rtwdev);
 	spin_lock_init(&rtwdev->h2c.lock);
 	spin_lock_init(&rtwdev->txq_lock);
 	spin_lock_init(&rtwdev->tx_report.q_lock);
@@ -1392,17 +1577,23 @@ int rtw_core_init(struct rtw_dev *rtwdev)
 	ret = rtw_load_firmware(rtwdev, RTW_NORMAL_FW);
 	if (ret) {
 		rtw_warn(rtwdev, "no firmware loaded\n");
-		return ret;
+		goto err_free_rx_hist;
 	}
 
 	if (chip->wow_supported) {
 		ret = rtw_load_firmware(rtwdev, RTW_WOWLAN_FW);
 		if (ret) {
 			rtw_warn(rtwdev, "no wow firmware loaded\n");
-			return ret;
+			goto err_free_rx_hist;
 		}
 	}
 	return 0;
+
+err_free_rx_hist:
+	vfree(rtwdev->rx_hist);
+	rtwdev->rx_hist = NULL;
+
+	return ret;
 }
 EXPORT_SYMBOL(rtw_core_init);
 
@@ -1413,6 +1604,8 @@ void rtw_core_deinit(struct rtw_dev *rtwdev)
 	struct rtw_rsvd_page *rsvd_pkt, *tmp;
 	unsigned long flags;
 
+	rtw_lps_ctrl_deinit(rtwdev);
+
 	if (fw->firmware)
 		release_firmware(fw->firmware);
 
@@ -1425,16 +1618,23 @@ void rtw_core_deinit(struct rtw_dev *rtwdev)
 
 	list_for_each_entry_safe(rsvd_pkt, tmp, &rtwdev->rsvd_page_list, list) {
 		list_del(&rsvd_pkt->list);
+		kfree_skb(rsvd_pkt->skb);
 		kfree(rsvd_pkt);
 	}
 
 	kfree(rtwdev->sar_rwrd);
 	kfree(rtwdev->sar_rwsi);
 	kfree(rtwdev->sar_rwgs);
+	vfree(rtwdev->rx_hist);
+	rtw_mac_pwr_prog_free(rtwdev);
+	rtw_phy_tables_free(rtwdev);
+	rtw_phy_tx_power_cache_free(rtwdev);
+	kfree(rtwdev->efuse.log_map);
 
 	mutex_destroy(&rtwdev->mutex);
 	mutex_destroy(&rtwdev->coex.mutex);
 	mutex_destroy(&rtwdev->hal.tx_power_mutex);
+	mutex_destroy(&rtwdev->dm_mutex);
 }
 EXPORT_SYMBOL(rtw_core_deinit);
 
@@ -36,6 +36,11 @@
 
 extern bool rtw_bf_support;
 extern unsigned int rtw_fw_lps_deep_mode;
+extern bool rtw_fw_support_lps;
+extern unsigned int rtw_lps_idle_gap_ms;
+extern unsigned int rtw_ips_mode;
+extern bool rtw_phy_tbl_precompile;
+extern unsigned int rtw_dm_period_ms;
 extern unsigned int rtw_debug_mask;
 extern bool rtw_allow_user_reg_set;
 extern const struct ieee80211_ops rtw_ops;
@@ -603,6 +608,65 @@ struct rtw_traffic_stats {
 	struct ewma_tp rx_ewma_tp;
 };
 
+struct rtw_c2h_stat {
+	u32 cnt;
+	/* from rx of C2H to the end of handling */
+	u32 latency_max_us;
+	u64 latency_sum_us;
+};
+
+#define RTW_RSVD_PG_CACHE_NUM	16
+
+struct rtw_rsvd_page_cache {
+	/* crc of the pages are what hardware has */
+	bool valid;
+	u8 page_num;
+	u32 crc[RTW_RSVD_PG_CACHE_NUM];
+
+	/* bytes downloaded by the last rtw_fw_download_rsvd_page() */
+	u32 last_dl_bytes;
+	u32 dl_cnt;
+	u64 total_dl_bytes;
+};
+
+#define RTW_H2C_QUEUE_LEN	16
+#define RTW_H2C_BOX_SIZE	8
+/* tries to empty the queue before the mail box becomes inaccessible */
+#define RTW_H2C_FLUSH_RETRY	20
+
+struct rtw_h2c_cmd {
+	u8 data[RTW_H2C_BOX_SIZE];
+	ktime_t queued;
+};
+
+#define RTW_RX_HIST_VERSION	1
+#define RTW_RX_RING_OCC_NUM	8
+
+struct rtw_rx_rate_stat {
+	u32 pkt_cnt;
+	u32 crc_err;
+	/* decrypt failures reported by hardware */
+	u32 icv_err;
+	u32 rsvd;
+	/* units in bytes */
+	u64 bytes;
+};
+
+/* This is exported as a binary blob through debugfs, new fields should
+ * only be appended and RTW_RX_HIST_VERSION bumped if the layout changes.
+ */
+struct rtw_rx_hist {
+	u8 version;
+	u8 mac_id_num;
+	u8 rate_num;
+	u8 ring_occ_num;
+	/* count of rx ring drains */
+	u32 drain_cnt;
+	/* pending descriptors per drain, in 1/RTW_RX_RING_OCC_NUM of ring */
+	u32 ring_occ[RTW_RX_RING_OCC_NUM];
+	struct rtw_rx_rate_stat stat[RTW_MAX_MAC_ID_NUM][DESC_RATE_MAX];
+};
+
 enum rtw_lps_mode {
 	RTW_MODE_ACTIVE	= 0,
 	RTW_MODE_LPS	= 1,
@@ -855,6 +919,26 @@ struct rtw_pwr_seq_cmd {
 	u8 value;
 };
 
+/* power sequence filtered by cut and interface, with base resolved */
+struct rtw_pwr_prog_cmd {
+	u32 offset;
+	u8 cmd;
+	u8 mask;
+	u8 value;
+};
+
+struct rtw_pwr_prog {
+	struct rtw_pwr_prog_cmd *cmds;
+	u32 num;
+	u8 cut;
+	bool compiled;
+
+	u32 cnt;
+	u32 last_us;
+	u32 max_us;
+	u64 total_us;
+};
+
 enum rtw_chip_ver {
 	RTW_CHIP_VER_CUT_A = 0x00,
 	RTW_CHIP_VER_CUT_B = 0x01,
@@ -993,6 +1077,58 @@ struct rtw_table {
 	enum rtw_rf_path rf_path;
 };
 
+enum rtw_phy_tbl_op {
+	RTW_PHY_OP_WRITE8,
+	RTW_PHY_OP_WRITE32,
+	RTW_PHY_OP_WRITE_RF,
+	RTW_PHY_OP_UDELAY,
+	RTW_PHY_OP_USLEEP,
+	RTW_PHY_OP_MDELAY,
+	RTW_PHY_OP_MSLEEP,
+	/* unknown do_cfg, call it with addr/data */
+	RTW_PHY_OP_CFG,
+	/* data writes from prog->writes[addr], see rtw_write_batch() */
+	RTW_PHY_OP_WRITE_BATCH,
+};
+
+struct rtw_phy_tbl_cmd {
+	u32 addr;
+	u32 data;
+	u8 op;
+};
+
+/* entries of a phy_cond table matching hal->phy_cond, in table order */
+struct rtw_phy_tbl_prog {
+	const struct rtw_table *tbl;
+	struct rtw_phy_tbl_cmd *cmds;
+	u32 num;
+	struct rtw_backup_info *writes;
+	u32 write_num;
+};
+
+struct rtw_phy_tbl_load_stat {
+	u32 cnt;
+	u32 last_us;
+	u32 max_us;
+	u64 total_us;
+};
+
+#define RTW_PHY_TBL_PROG_NUM	(4 + RTW_RF_PATH_MAX)
+
+struct rtw_phy_tbl_cache {
+	struct rtw_phy_tbl_prog prog[RTW_PHY_TBL_PROG_NUM];
+	u8 prog_num;
+	u32 tile_num;
+	u32 compile_us;
+	/* rtw_phy_load_tables() time, [0] parsed, [1] precompiled */
+	struct rtw_phy_tbl_load_stat load[2];
+
+	/* register accesses of the last precompiled load */
+	u32 reg_write_cnt;
+	u32 batch_cnt;
+	u32 rf_write_cnt;
+};
+
 static inline void rtw_load_table(struct rtw_dev *rtwdev,
 				  const struct rtw_table *tbl)
 {
@@ -1092,6 +1228,9 @@ struct rtw_chip_info {
 	u32 rf_sipi_addr[2];
 	struct rtw_rf_sipi_addr *rf_sipi_read_addr;
 	u8 rf_phy_nr;
+	/* RF registers changed by hardware, setting it enables RF shadow */
+	const u8 *rf_volatile_regs;
+	u8 rf_volatile_num;
 	struct rtw_ltecoex_addr *ltecoex_addr;
 
 	const struct rtw_table *mac_tbl;
@@ -1386,6 +1525,71 @@ struct rtw_iqk_info {
 	} result;
 };
 
+#define RTW_CALI_CACHE_NUM	16
+#define RTW_CALI_DATA_NUM	8
+
+/* calibration result of a channel group, bandwidth and temperature */
+struct rtw_cali_cache_entry {
+	bool valid;
+	u8 band;
+	u8 ch_group;
+	u8 bw;
+	u8 thermal;
+	u32 last_use;
+	u32 cali_us;
+	s32 data[RTW_CALI_DATA_NUM];
+};
+
+struct rtw_cali_cache {
+	struct rtw_cali_cache_entry entry[RTW_CALI_CACHE_NUM];
+	u32 stamp;
+	u32 hit_cnt;
+	u32 miss_cnt;
+	u64 saved_us;
+	u64 cali_us;
+};
+
+#define RTW_PWRTRACK_TRACE_NUM	32
+/* thermal sampling interval, in watchdog periods */
+#define RTW_PWRTRACK_FAST_TICKS	1
+#define RTW_PWRTRACK_SLOW_TICKS	4
+/* samples without thermal change before sampling slows down */
+#define RTW_PWRTRACK_STABLE_CNT	8
+
+enum rtw_pwrtrack_apply {
+	RTW_PWRTRACK_APPLY_OFDM		= BIT(0),
+	RTW_PWRTRACK_APPLY_CCK		= BIT(1),
+	RTW_PWRTRACK_APPLY_TXAGC	= BIT(2),
+	RTW_PWRTRACK_APPLY_XTAL		= BIT(3),
+	RTW_PWRTRACK_APPLY_IQK		= BIT(4),
+};
+
+struct rtw_pwrtrack_trace {
+	u32 time_ms;
+	u8 apply;
+	u8 thermal[RTW_RF_PATH_MAX];
+	s8 pwr_idx[RTW_RF_PATH_MAX];
+};
+
+struct rtw_pwrtrack_info {
+	/* the registers hold the settings below and delta_power_index_last */
+	bool valid;
+	s8 ofdm_swing_idx;
+	s8 cck_swing_idx;
+	u8 xtal_cap;
+
+	u8 interval;
+	u8 countdown;
+	u8 stable_cnt;
+	u8 thermal_last[RTW_RF_PATH_MAX];
+	u32 sample_cnt;
+	u32 skip_cnt;
+
+	struct rtw_pwrtrack_trace trace[RTW_PWRTRACK_TRACE_NUM];
+	u8 trace_head;
+	u32 trace_cnt;
+};
+
 struct rtw_dm_info {
 	u32 cck_fa_cnt;
 	u32 ofdm_fa_cnt;
@@ -1452,6 +1656,10 @@ struct rtw_dm_info {
 	struct ewma_snr ewma_snr[RTW_SNR_NUM];
 
 	struct rtw_iqk_info iqk;
+	/* protected by dm_lock */
+	struct rtw_cali_cache cali_cache;
+	/* protected by rtwdev->mutex */
+	struct rtw_pwrtrack_info pwrtrack;
 };
 
 struct rtw_efuse {
@@ -1460,6 +1668,10 @@ struct rtw_efuse {
 	u32 logical_size;
 	u32 protect_size;
 
+	/* logical map cached after the first read */
+	u8 *log_map;
+	u32 phy_read_size;
+
 	u8 addr[ETH_ALEN];
 	u8 channel_plan;
 	u8 country_code[2];
@@ -1554,13 +1766,257 @@ struct rtw_fifo_conf {
 	struct rtw_rqpn *rqpn;
 };
 
+enum rtw_fw_section_type {
+	RTW_FW_SECTION_DMEM,
+	RTW_FW_SECTION_IMEM,
+	RTW_FW_SECTION_EMEM,
+
+	RTW_FW_SECTION_NUM,
+};
+
+struct rtw_fw_section {
+	const u8 *data;
+	u32 addr;
+	u32 size;
+};
+
 struct rtw_fw_state {
+	struct rtw_dev *rtwdev;
 	const struct firmware *firmware;
 	struct completion completion;
+	struct rtw_fw_section section[RTW_FW_SECTION_NUM];
+	u8 section_num;
 	u16 version;
 	u8 sub_version;
 	u8 sub_index;
 	u16 h2c_version;
+
+	/* time spent on each phase of the last download */
+	u32 dl_time_us;
+	u32 dl_txbuf_us;
+	u32 dl_ddma_us;
+	u32 dl_validate_us;
+	u32 dl_cnt;
+};
+
+struct rtw_flush_stats {
+	u32 cnt;
+	u32 drop_cnt;
+	u32 timeout_cnt;
+	u32 last_us;
+	u32 max_us;
+	u64 total_us;
+};
+
+enum rtw_ips_mode {
+	RTW_IPS_MODE_PWR_OFF,
+	RTW_IPS_MODE_BB_OFF,
+
+	RTW_IPS_MODE_NUM,
+};
+
+struct rtw_ips {
+	/* MAC and firmware kept powered, see rtw_core_bb_off() */
+	bool bb_off;
+	u8 txpause;
+
+	u32 enter_cnt[RTW_IPS_MODE_NUM];
+	u32 leave_cnt[RTW_IPS_MODE_NUM];
+	u32 leave_last_us[RTW_IPS_MODE_NUM];
+	u32 leave_max_us[RTW_IPS_MODE_NUM];
+	u64 leave_total_us[RTW_IPS_MODE_NUM];
+};
+
+#define RTW_RF_SHADOW_SIZE	0x100
+
+/* RF registers last written with full mask by driver, only kept for chips
+ * whose firmware does not write RF behind the driver, see rtw_read_rf()
+ */
+struct rtw_rf_shadow {
+	u32 val[RTW_RF_PATH_MAX][RTW_RF_SHADOW_SIZE];
+	DECLARE_BITMAP(valid[RTW_RF_PATH_MAX], RTW_RF_SHADOW_SIZE);
+	DECLARE_BITMAP(volatile_map, RTW_RF_SHADOW_SIZE);
+
+	u32 hit_cnt;
+	u32 miss_cnt;
+	u32 rmw_hit_cnt;
+	u32 rmw_miss_cnt;
+};
+
+#define RTW_DEEP_PS_HIST_NUM	16
+
+/* deep PS leave latency per deep mode, bucket i counts waits under 2^i us */
+struct rtw_deep_ps_stats {
+	u32 hist[LPS_DEEP_MODE_PG + 1][RTW_DEEP_PS_HIST_NUM];
+	u32 irq_cnt;
+	u32 poll_cnt;
+	u32 retry_cnt;
+	u32 fail_cnt;
+	u32 max_us;
+};
+
+#define RTW_DM_PERIOD_MS	250
+#define RTW_DM_PERIOD_MIN_MS	50
+#define RTW_DM_PERIOD_MAX_MS	2000
+
+/* DIG and CCK PD run at their own period, see rtw_phy_dm_engine_work() */
+struct rtw_dm_engine {
+	struct delayed_work work;
+	bool enabled;
+	u32 period_ms;
+	ktime_t last_fa;
+
+	u32 run_cnt;
+	u32 skip_cnt;
+
+	/* IGI convergence, from its first step to the last before settling */
+	bool converging;
+	u8 stable_cnt;
+	u8 conv_start_igi;
+	u8 conv_steps;
+	ktime_t conv_start;
+	ktime_t conv_last_step;
+
+	u32 conv_cnt;
+	u32 conv_last_ms;
+	u32 conv_max_ms;
+	u64 conv_total_ms;
+};
+
+/* traffic driven LPS entry/exit, see rtw_lps_ctrl_traffic() */
+struct rtw_lps_ctrl {
+	struct hrtimer idle_timer;
+	struct work_struct enter_work;
+	struct work_struct leave_work;
+
+	/* last TX/RX data activity, and traffic seen since entering LPS */
+	ktime_t last_activity;
+	u32 burst_cnt;
+	u32 ac_cnt[IEEE80211_NUM_ACS];
+
+	ktime_t enter_time;
+	u64 residency_us;
+
+	u32 enter_cnt;
+	u32 idle_enter_cnt;
+	u32 enter_last_us;
+	u32 enter_max_us;
+	u64 enter_total_us;
+
+	u32 leave_cnt;
+	u32 predict_leave_cnt;
+	u32 leave_last_us;
+	u32 leave_max_us;
+	u64 leave_total_us;
+};
+
+#define RTW_POLL_STAT_NUM	24
+
+/* wait time of hardware polls, accumulated per call site */
+struct rtw_poll_stat {
+	unsigned long ip;
+	u32 cnt;
+	u32 timeout_cnt;
+	u32 max_us;
+	u64 total_us;
+};
+
+struct rtw_poll_stats {
+	spinlock_t lock;
+	u32 overflow_cnt;
+	struct rtw_poll_stat stat[RTW_POLL_STAT_NUM];
+};
+
+/* time since probe, in us, of each milestone, 0 if not reached yet */
+struct rtw_boot_time {
+	ktime_t probe;
+	u32 fw_loaded;
+	u32 chip_setup;
+	u32 first_start;
+	u32 first_link;
+};
+
+enum rtw_chsw_stage {
+	RTW_CHSW_RF,
+	RTW_CHSW_SPUR,
+	RTW_CHSW_MAC,
+	RTW_CHSW_BB,
+	RTW_CHSW_CHIP,
+	RTW_CHSW_COEX,
+	RTW_CHSW_TXPWR,
+	RTW_CHSW_TOTAL,
+
+	RTW_CHSW_STAGE_NUM,
+};
+
+#define RTW_CHSW_HIST_NUM	16
+
+/* time spent in each stage of rtw_set_channel(), see rtw_set_channel_stage() */
+struct rtw_chsw_stats {
+	ktime_t start;
+	ktime_t last;
+	u32 hist[RTW_CHSW_STAGE_NUM][RTW_CHSW_HIST_NUM];
+	u32 cnt[RTW_CHSW_STAGE_NUM];
+	u32 max_us[RTW_CHSW_STAGE_NUM];
+	u64 total_us[RTW_CHSW_STAGE_NUM];
+	u32 fast_cnt;
+};
+
+/* bandwidth settings last programmed to MAC and BB, MAC and BB writes that
+ * depend only on them are skipped while they are unchanged
+ */
+struct rtw_chsw_state {
+	bool valid;
+	bool bw_unchanged;
+	u8 band_class;
+	u8 bw;
+	u8 primary_chan_idx;
+};
+
+#define RTW_TX_PWR_CACHE_CH_NUM	(RTW_MAX_CHANNEL_NUM_2G + RTW_MAX_CHANNEL_NUM_5G)
+
+/* tx power index of each rate before the txagc remnant is added, the power
+ * limit depends on the primary channel through cch_by_bw
+ */
+struct rtw_tx_pwr_cache_entry {
+	bool valid;
+	u8 cch_by_bw[RTW_MAX_CHANNEL_WIDTH + 1];
+	u8 pwr_idx[RTW_RF_PATH_MAX][DESC_RATE_MAX];
+};
+
+/* indexed by center channel and bandwidth, entries are computed for regd
+ * and the cch_by_bw they hold only
+ */
+struct rtw_tx_pwr_cache {
+	struct rtw_tx_pwr_cache_entry *entry;
+	u8 regd;
+	u32 hit_cnt;
+	u32 miss_cnt;
+	u32 flush_cnt;
+};
+
+#define RTW_TXAGC_REG_MAX	64
+
+struct rtw_txagc_reg {
+	u32 addr;
+	u32 mask;
+	u32 val;
+};
+
+/* tx power index registers pending for the current set_tx_power_index, and
+ * the bits programmed by the previous ones
+ */
+struct rtw_txagc_writer {
+	struct rtw_txagc_reg pend[RTW_TXAGC_REG_MAX];
+	u8 pend_num;
+	struct rtw_txagc_reg last[RTW_TXAGC_REG_MAX];
+	u8 last_num;
+
+	u32 set_cnt;
+	u32 read_cnt;
+	u32 write_cnt;
+	u32 skip_cnt;
+	u64 total_mmio;
 };
 
 struct rtw_hal {
@@ -1584,6 +2040,8 @@ struct rtw_hal {
 	u8 cch_by_bw[RTW_MAX_CHANNEL_WIDTH + 1];
 
 	u8 sec_ch_offset;
+	struct rtw_chsw_state chsw;
+	struct rtw_chsw_stats chsw_stats;
 	u8 rf_type;
 	u8 rf_path_num;
 	u8 antenna_tx;
@@ -1614,6 +2072,8 @@ struct rtw_hal {
 			[RTW_MAX_CHANNEL_NUM_5G];
 	s8 tx_pwr_tbl[RTW_RF_PATH_MAX]
 		     [DESC_RATE_MAX];
+	struct rtw_tx_pwr_cache tx_pwr_cache;
+	struct rtw_txagc_writer txagc;
 };
 
 struct sar_rwrd;
@@ -1632,9 +2092,16 @@ struct rtw_dev {
 	struct rtw_fifo_conf fifo;
 	struct rtw_fw_state fw;
 	struct rtw_fw_state wow_fw;
+	struct rtw_boot_time boot_time;
+	struct rtw_poll_stats poll_stats;
+	struct rtw_flush_stats flush_stats;
+
+	struct rtw_pwr_prog pwr_on_prog;
+	struct rtw_pwr_prog pwr_off_prog;
 	struct rtw_efuse efuse;
 	struct rtw_sec_desc sec;
 	struct rtw_traffic_stats stats;
+	struct rtw_rx_hist *rx_hist;
 	struct rtw_regulatory regd;
 	struct rtw_bf_info bf_info;
 
@@ -1646,18 +2113,24 @@ struct rtw_dev {
 
 	/* lock for dm to use */
 	spinlock_t dm_lock;
+	/* serialize BB access of dm engine against channel switch and LPS */
+	struct mutex dm_mutex;
+	struct rtw_dm_engine dm_engine;
 
 	/* read/write rf register */
 	spinlock_t rf_lock;
+	struct rtw_rf_shadow rf_shadow;
 
 	/* watch dog every 2 sec */
 	struct delayed_work watch_dog_work;
 	u32 watch_dog_cnt;
 
 	struct list_head rsvd_page_list;
+	struct rtw_rsvd_page_cache rsvd_page_cache;
 
 	/* c2h cmd queue & handler work */
 	struct sk_buff_head c2h_queue;
+	struct rtw_c2h_stat c2h_stats[U8_MAX + 1];
 	struct work_struct c2h_work;
 
 	/* protect list of txqs */
@@ -1673,11 +2146,26 @@ struct rtw_dev {
 		/* protect to send h2c to fw */
 		spinlock_t lock;
 		u32 seq;
+
+		/* commands waiting for a free mail box, oldest first */
+		struct rtw_h2c_cmd queue[RTW_H2C_QUEUE_LEN];
+		u8 queue_len;
+		struct delayed_work work;
+
+		u32 sent_cnt;
+		u32 coalesce_cnt;
+		u32 drop_cnt;
+		u32 latency_max_us;
+		u64 latency_sum_us;
 	} h2c;
 
 	/* lps power state & handler work */
 	struct rtw_lps_conf lps_conf;
 	struct delayed_work lps_work;
+	struct rtw_lps_ctrl lps_ctrl;
+	struct rtw_deep_ps_stats deep_ps_stats;
+	struct rtw_ips ips;
+	struct rtw_phy_tbl_cache phy_tbl;
 
 	struct dentry *debugfs;
 
@@ -1736,6 +2224,13 @@ static inline void rtw_efuse_en(struct rtw_dev *rtwdev, bool enable)
 		rtwdev->chip->ops->efuse_en(rtwdev, enable);
 }
 
+static inline void rtw_boot_time_mark(struct rtw_dev *rtwdev, u32 *mark)
+{
+	if (!*mark)
+		*mark = max_t(s64, 1, ktime_us_delta(ktime_get(),
+						     rtwdev->boot_time.probe));
+}
+
 static inline bool rtw_chip_wcpu_11n(struct rtw_dev *rtwdev)
 {
 	return rtwdev->chip->wlan_cpu == RTW_WCPU_11N;
@@ -1744,18 +2239,31 @@ static inline bool rtw_chip_wcpu_11n(struct rtw_dev *rtwdev)
 void rtw_get_channel_params(struct cfg80211_chan_def *chandef,
 			    struct rtw_channel_params *ch_param);
 bool check_hw_ready(struct rtw_dev *rtwdev, u32 addr, u32 mask, u32 target);
+int rtw_poll32(struct rtw_dev *rtwdev, u32 addr, u32 mask, u32 target);
+int rtw_poll32_timeout(struct rtw_dev *rtwdev, u32 addr, u32 mask, u32 target,
+		       u32 timeout_us);
 bool ltecoex_read_reg(struct rtw_dev *rtwdev, u16 offset, u32 *val);
 bool ltecoex_reg_write(struct rtw_dev *rtwdev, u16 offset, u32 value);
 void rtw_restore_reg(struct rtw_dev *rtwdev,
 		     struct rtw_backup_info *bckp, u32 num);
+u32 rtw_rf_shadow_read(struct rtw_dev *rtwdev, enum rtw_rf_path rf_path,
+		       u32 addr, u32 mask);
+void rtw_rf_shadow_write(struct rtw_dev *rtwdev, enum rtw_rf_path rf_path,
+			 u32 addr, u32 mask, u32 data);
+void rtw_rf_shadow_invalidate(struct rtw_dev *rtwdev);
+void rtw_rf_shadow_init(struct rtw_dev *rtwdev);
 void rtw_desc_to_mcsrate(u16 rate, u8 *mcs, u8 *nss);
 void rtw_set_channel(struct rtw_dev *rtwdev);
+void rtw_set_channel_stage(struct rtw_dev *rtwdev, enum rtw_chsw_stage stage);
+void rtw_set_channel_invalidate(struct rtw_dev *rtwdev);
 void rtw_vif_port_config(struct rtw_dev *rtwdev, struct rtw_vif *rtwvif,
 			 u32 config);
 void rtw_tx_report_purge_timer(struct timer_list *t);
 void rtw_update_sta_info(struct rtw_dev *rtwdev, struct rtw_sta_info *si);
 int rtw_core_start(struct rtw_dev *rtwdev);
 void rtw_core_stop(struct rtw_dev *rtwdev);
+void rtw_core_bb_off(struct rtw_dev *rtwdev);
+void rtw_core_bb_on(struct rtw_dev *rtwdev);
 int rtw_chip_info_setup(struct rtw_dev *rtwdev);
 int rtw_core_init(struct rtw_dev *rtwdev);
 void rtw_core_deinit(struct rtw_dev *rtwdev);
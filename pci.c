@@ -92,6 +92,50 @@ static void rtw_pci_write32(struct rtw_dev *rtwdev, u32 addr, u32 val)
 	writel(val, rtwpci->mmap + addr);
 }
 
+static void rtw_pci_write_block32(struct rtw_dev *rtwdev, u32 addr,
+				  const __le32 *data, u32 count)
+{
+	struct rtw_pci *rtwpci = (struct rtw_pci *)rtwdev->priv;
+
+	/* raw writes without per-dword barrier, data is already in the
+	 * byte order the device expects
+	 */
+	__iowrite32_copy(rtwpci->mmap + addr, data, count);
+	wmb();
+}
+
+static void rtw_pci_write_batch(struct rtw_dev *rtwdev,
+				const struct rtw_backup_info *regs, u32 num)
+{
+	struct rtw_pci *rtwpci = (struct rtw_pci *)rtwdev->priv;
+	void __iomem *mmap = rtwpci->mmap;
+	u32 i;
+
+	if (!num)
+		return;
+
+	/* relaxed writes stay in order to the device, read back once at the
+	 * end to flush them instead of a barrier per register
+	 */
+	for (i = 0; i < num; i++) {
+		switch (regs[i].len) {
+		case 1:
+			writeb_relaxed(regs[i].val, mmap + regs[i].reg);
+			break;
+		case 2:
+			writew_relaxed(regs[i].val, mmap + regs[i].reg);
+			break;
+		case 4:
+			writel_relaxed(regs[i].val, mmap + regs[i].reg);
+			break;
+		default:
+			break;
+		}
+	}
+
+	readl(mmap + (regs[num - 1].reg & ~0x3));
+}
+
 static inline void *rtw_pci_get_tx_desc(struct rtw_pci_tx_ring *tx_ring, u8 idx)
 {
 	int offset = tx_ring->r.desc_size * idx;
@@ -370,6 +414,8 @@ static void rtw_pci_deinit(struct rtw_dev *rtwdev)
 	rtw_pci_free_trx_ring(rtwdev);
 }
 
+static void rtw_pci_rx_recovery_work(struct work_struct *work);
+
 static int rtw_pci_init(struct rtw_dev *rtwdev)
 {
 	struct rtw_pci *rtwpci = (struct rtw_pci *)rtwdev->priv;
@@ -382,13 +428,19 @@ static int rtw_pci_init(struct rtw_dev *rtwdev)
 			      IMR_VIDOK |
 			      IMR_VODOK |
 			      IMR_ROK |
+			      IMR_RDU |
 			      IMR_BCNDMAINT_E |
+			      IMR_CPWM |
 			      0;
 	rtwpci->irq_mask[1] = IMR_TXFOVW |
+			      IMR_RXFOVW |
 			      0;
 	rtwpci->irq_mask[3] = IMR_H2CDOK |
 			      0;
 	spin_lock_init(&rtwpci->irq_lock);
+	INIT_WORK(&rtwpci->rx_rcvy.work, rtw_pci_rx_recovery_work);
+	init_waitqueue_head(&rtwpci->tx_flush_wq);
+	init_completion(&rtwpci->cpwm_done);
 	ret = rtw_pci_init_trx_ring(rtwdev);
 
 	return ret;
@@ -531,6 +583,129 @@ static void rtw_pci_dma_release(struct rtw_dev *rtwdev, struct rtw_pci *rtwpci)
 	}
 }
 
+static void rtw_pci_rx_recovery_reset(struct rtw_pci *rtwpci)
+{
+	struct rtw_pci_rx_recovery *rx_rcvy = &rtwpci->rx_rcvy;
+
+	rx_rcvy->state = RTW_PCI_RX_NORMAL;
+	rx_rcvy->tag_err = 0;
+	rx_rcvy->stall_cnt = 0;
+
+	rtwpci->irq_mask[0] |= IMR_ROK | IMR_RDU;
+	rtwpci->irq_mask[1] |= IMR_RXFOVW;
+}
+
+static void rtw_pci_rx_recovery_trigger(struct rtw_dev *rtwdev,
+					struct rtw_pci *rtwpci)
+{
+	struct rtw_pci_rx_recovery *rx_rcvy = &rtwpci->rx_rcvy;
+
+	lockdep_assert_held(&rtwpci->irq_lock);
+
+	if (rx_rcvy->state != RTW_PCI_RX_NORMAL)
+		return;
+
+	/* keep rx interrupts masked until the ring is re-seeded */
+	rx_rcvy->state = RTW_PCI_RX_RECOVERING;
+	rtwpci->irq_mask[0] &= ~(IMR_ROK | IMR_RDU);
+	rtwpci->irq_mask[1] &= ~IMR_RXFOVW;
+
+	ieee80211_queue_work(rtwdev->hw, &rx_rcvy->work);
+}
+
+/* RDU under heavy rx is normal as long as frames are still handled, only a
+ * run of RDU/RXFOVW without rx progress means the rx dma is stalled
+ */
+static void rtw_pci_rx_stall_check(struct rtw_dev *rtwdev,
+				   struct rtw_pci *rtwpci)
+{
+	struct rtw_pci_rx_recovery *rx_rcvy = &rtwpci->rx_rcvy;
+
+	if (rx_rcvy->stall_cnt++ == 0)
+		rx_rcvy->stall_start = jiffies;
+
+	if (rx_rcvy->stall_cnt >= RTW_PCI_RX_STALL_THRES &&
+	    time_after_eq(jiffies,
+			  rx_rcvy->stall_start + RTW_PCI_RX_STALL_PERIOD))
+		rtw_pci_rx_recovery_trigger(rtwdev, rtwpci);
+}
+
+static void rtw_pci_rx_ring_reseed(struct rtw_dev *rtwdev,
+				   struct rtw_pci_rx_ring *rx_ring)
+{
+	u32 desc_sz = rtwdev->chip->rx_buf_desc_sz;
+	struct sk_buff *skb;
+	dma_addr_t dma;
+	u32 i;
+
+	/* give all of the rx buffers back to hardware */
+	for (i = 0; i < rx_ring->r.len; i++) {
+		skb = rx_ring->buf[i];
+		dma = *((dma_addr_t *)skb->cb);
+		rtw_pci_sync_rx_desc_device(rtwdev, dma, rx_ring, i, desc_sz);
+	}
+}
+
+/* only the rx ring is reset, tx, h2c and beacon rings are left running */
+static void rtw_pci_reset_rx_buf_desc(struct rtw_dev *rtwdev,
+				      struct rtw_pci_rx_ring *rx_ring)
+{
+	rx_ring->r.rp = 0;
+	rx_ring->r.wp = 0;
+	rtw_write16(rtwdev, RTK_PCI_RXBD_NUM_MPDUQ, rx_ring->r.len & 0xfff);
+	rtw_write32(rtwdev, RTK_PCI_RXBD_DESA_MPDUQ, rx_ring->r.dma);
+	rtw_write32(rtwdev, RTK_PCI_TXBD_RWPTR_CLR,
+		    BIT_CLR_RXQ_HW_IDX | BIT_CLR_RXQ_HOST_IDX);
+}
+
+static void rtw_pci_rx_recovery_work(struct work_struct *work)
+{
+	struct rtw_pci_rx_recovery *rx_rcvy =
+			container_of(work, struct rtw_pci_rx_recovery, work);
+	struct rtw_pci *rtwpci = container_of(rx_rcvy, struct rtw_pci, rx_rcvy);
+	struct ieee80211_hw *hw = pci_get_drvdata(rtwpci->pdev);
+	struct rtw_dev *rtwdev = hw->priv;
+	struct rtw_pci_rx_ring *rx_ring = &rtwpci->rx_rings[RTW_RX_QUEUE_MPDU];
+	unsigned long flags;
+
+	mutex_lock(&rtwdev->mutex);
+
+	/* rtw_pci_start() will reset the state if stopped meanwhile */
+	if (!test_bit(RTW_FLAG_RUNNING, rtwdev->flags))
+		goto out;
+
+	rtw_leave_lps_deep(rtwdev);
+
+	/* halt rx dma, no buffer may be written while the ring is re-seeded */
+	rtw_write32_set(rtwdev, REG_RXPKT_NUM, BIT_RW_RELEASE);
+	if (rtw_poll32(rtwdev, REG_RXPKT_NUM, BIT_RXDMA_IDLE, 1))
+		rtw_warn(rtwdev, "failed to halt rx dma\n");
+
+	spin_lock_irqsave(&rtwpci->irq_lock, flags);
+
+	rtw_pci_disable_interrupt(rtwdev, rtwpci);
+
+	rtw_pci_rx_ring_reseed(rtwdev, rx_ring);
+	rtw_pci_reset_rx_buf_desc(rtwdev, rx_ring);
+	rx_rcvy->tag_resync = true;
+	rtw_write32_clr(rtwdev, REG_RXPKT_NUM, BIT_RW_RELEASE);
+
+	rtw_pci_rx_recovery_reset(rtwpci);
+	rx_rcvy->recover_cnt++;
+
+	rtw_pci_enable_interrupt(rtwdev, rtwpci);
+
+	spin_unlock_irqrestore(&rtwpci->irq_lock, flags);
+
+	rtw_warn(rtwdev,
+		 "rx dma recovered, count=%u tag_mismatch=%u rdu=%u rxfovw=%u\n",
+		 rx_rcvy->recover_cnt, rx_rcvy->tag_mismatch_cnt,
+		 rx_rcvy->rdu_cnt, rx_rcvy->rxfovw_cnt);
+
+out:
+	mutex_unlock(&rtwdev->mutex);
+}
+
 static int rtw_pci_start(struct rtw_dev *rtwdev)
 {
 	struct rtw_pci *rtwpci = (struct rtw_pci *)rtwdev->priv;
@@ -539,6 +714,8 @@ static int rtw_pci_start(struct rtw_dev *rtwdev)
 	rtw_pci_dma_reset(rtwdev, rtwpci);
 
 	spin_lock_irqsave(&rtwpci->irq_lock, flags);
+	rtwpci->rx_rcvy.tag_resync = false;
+	rtw_pci_rx_recovery_reset(rtwpci);
 	rtw_pci_enable_interrupt(rtwdev, rtwpci);
 	spin_unlock_irqrestore(&rtwpci->irq_lock, flags);
 
@@ -599,8 +776,54 @@ static void rtw_pci_deep_ps_leave(struct rtw_dev *rtwdev)
 
 	lockdep_assert_held(&rtwpci->irq_lock);
 
-	if (test_and_clear_bit(RTW_FLAG_LEISURE_PS_DEEP, rtwdev->flags))
-		rtw_power_mode_change(rtwdev, false);
+	if (!test_and_clear_bit(RTW_FLAG_LEISURE_PS_DEEP, rtwdev->flags))
+		return;
+
+	/* a sleeping leave is in progress, finish it here as TX cannot wait */
+	if (rtwpci->cpwm_waking) {
+		rtwpci->cpwm_waking = false;
+		rtw_power_mode_leave_confirm(rtwdev, rtwpci->cpwm_confirm,
+					     rtwpci->cpwm_start, false);
+		return;
+	}
+
+	rtw_power_mode_change(rtwdev, false);
+}
+
+/* leave deep PS from process context, sleep until firmware acks with the
+ * CPWM interrupt instead of spinning with irq_lock held
+ */
+static void rtw_pci_deep_ps_wake(struct rtw_dev *rtwdev)
+{
+	struct rtw_pci *rtwpci = (struct rtw_pci *)rtwdev->priv;
+	unsigned long flags;
+	bool irq;
+
+	spin_lock_irqsave(&rtwpci->irq_lock, flags);
+	if (!test_bit(RTW_FLAG_LEISURE_PS_DEEP, rtwdev->flags) ||
+	    rtwpci->cpwm_waking) {
+		spin_unlock_irqrestore(&rtwpci->irq_lock, flags);
+		return;
+	}
+
+	reinit_completion(&rtwpci->cpwm_done);
+	rtwpci->cpwm_start = ktime_get();
+	rtwpci->cpwm_confirm = rtw_power_mode_leave_request(rtwdev);
+	rtwpci->cpwm_waking = true;
+	spin_unlock_irqrestore(&rtwpci->irq_lock, flags);
+
+	irq = wait_for_completion_timeout(&rtwpci->cpwm_done,
+					  RTW_PCI_CPWM_TIMEOUT);
+
+	spin_lock_irqsave(&rtwpci->irq_lock, flags);
+	/* TX path could have completed the leave meanwhile */
+	if (rtwpci->cpwm_waking) {
+		rtwpci->cpwm_waking = false;
+		clear_bit(RTW_FLAG_LEISURE_PS_DEEP, rtwdev->flags);
+		rtw_power_mode_leave_confirm(rtwdev, rtwpci->cpwm_confirm,
+					     rtwpci->cpwm_start, irq);
+	}
+	spin_unlock_irqrestore(&rtwpci->irq_lock, flags);
 }
 
 static void rtw_pci_deep_ps(struct rtw_dev *rtwdev, bool enter)
@@ -608,14 +831,16 @@ static void rtw_pci_deep_ps(struct rtw_dev *rtwdev, bool enter)
 	struct rtw_pci *rtwpci = (struct rtw_pci *)rtwdev->priv;
 	unsigned long flags;
 
+	if (!enter) {
+		rtw_pci_deep_ps_wake(rtwdev);
+		return;
+	}
+
 	spin_lock_irqsave(&rtwpci->irq_lock, flags);
 
-	if (enter && !test_bit(RTW_FLAG_LEISURE_PS_DEEP, rtwdev->flags))
+	if (!test_bit(RTW_FLAG_LEISURE_PS_DEEP, rtwdev->flags))
 		rtw_pci_deep_ps_enter(rtwdev);
 
-	if (!enter && test_bit(RTW_FLAG_LEISURE_PS_DEEP, rtwdev->flags))
-		rtw_pci_deep_ps_leave(rtwdev);
-
 	spin_unlock_irqrestore(&rtwpci->irq_lock, flags);
 }
 
@@ -645,6 +870,44 @@ static u8 rtw_hw_queue_mapping(struct sk_buff *skb)
 	return queue;
 }
 
+static bool rtw_pci_tx_queues_empty(struct rtw_pci *rtwpci, u32 pci_queues)
+{
+	u8 queue;
+
+	for (queue = 0; queue < RTK_MAX_TX_QUEUE_NUM; queue++) {
+		if (!(pci_queues & BIT(queue)))
+			continue;
+
+		if (skb_queue_len(&rtwpci->tx_rings[queue].queue))
+			return false;
+	}
+
+	return true;
+}
+
+static int rtw_pci_flush_queues(struct rtw_dev *rtwdev, u32 queues, bool drop)
+{
+	struct rtw_pci *rtwpci = (struct rtw_pci *)rtwdev->priv;
+	u32 pci_queues = BIT(RTW_TX_QUEUE_MGMT) | BIT(RTW_TX_QUEUE_HI0);
+	u8 ac;
+
+	for (ac = 0; ac < IEEE80211_NUM_ACS; ac++)
+		if (queues & BIT(ac))
+			pci_queues |= BIT(ac_to_hwq[ac]);
+
+	/* frames are allowed to be dropped, don't wait for them */
+	if (drop)
+		return 0;
+
+	/* sleep until tx isr reclaims the rings instead of polling */
+	if (!wait_event_timeout(rtwpci->tx_flush_wq,
+				rtw_pci_tx_queues_empty(rtwpci, pci_queues),
+				RTW_PCI_FLUSH_TIMEOUT))
+		return -ETIMEDOUT;
+
+	return 0;
+}
+
 static void rtw_pci_release_rsvd_page(struct rtw_pci *rtwpci,
 				      struct rtw_pci_tx_ring *ring)
 {
@@ -667,6 +930,7 @@ static void rtw_pci_dma_check(struct rtw_dev *rtwdev,
 			      u32 idx)
 {
 	struct rtw_pci *rtwpci = (struct rtw_pci *)rtwdev->priv;
+	struct rtw_pci_rx_recovery *rx_rcvy = &rtwpci->rx_rcvy;
 	struct rtw_chip_info *chip = rtwdev->chip;
 	struct rtw_pci_rx_buffer_desc *buf_desc;
 	u32 desc_sz = chip->rx_buf_desc_sz;
@@ -676,9 +940,21 @@ static void rtw_pci_dma_check(struct rtw_dev *rtwdev,
 						     idx * desc_sz);
 	total_pkt_size = le16_to_cpu(buf_desc->total_pkt_size);
 
-	/* rx tag mismatch, throw a warning */
-	if (total_pkt_size != rtwpci->rx_tag)
+	/* first frame after an rx ring reset, follow the hardware rx tag */
+	if (rx_rcvy->tag_resync) {
+		rx_rcvy->tag_resync = false;
+		rtwpci->rx_tag = total_pkt_size;
+	}
+
+	/* rx tag mismatch, throw a warning and reset rx dma if it persists */
+	if (total_pkt_size != rtwpci->rx_tag) {
 		rtw_warn(rtwdev, "pci bus timeout, check dma status\n");
+		rx_rcvy->tag_mismatch_cnt++;
+		if (++rx_rcvy->tag_err >= RTW_PCI_RX_TAG_ERR_THRES)
+			rtw_pci_rx_recovery_trigger(rtwdev, rtwpci);
+	} else {
+		rx_rcvy->tag_err = 0;
+	}
 
 	rtwpci->rx_tag = (rtwpci->rx_tag + 1) % RX_TAG_MAX;
 }
@@ -759,8 +1035,8 @@ static int rtw_pci_xmit(struct rtw_dev *rtwdev,
 	return 0;
 }
 
-static int rtw_pci_write_data_rsvd_page(struct rtw_dev *rtwdev, u8 *buf,
-					u32 size)
+static int rtw_pci_write_data_rsvd_page(struct rtw_dev *rtwdev,
+					const u8 *buf, u32 size)
 {
 	struct sk_buff *skb;
 	struct rtw_tx_pkt_info pkt_info;
@@ -936,6 +1212,9 @@ static void rtw_pci_tx_isr(struct rtw_dev *rtwdev, struct rtw_pci *rtwpci,
 	}
 
 	ring->r.rp = cur_rp;
+
+	if (wq_has_sleeper(&rtwpci->tx_flush_wq))
+		wake_up(&rtwpci->tx_flush_wq);
 }
 
 static void rtw_pci_rx_isr(struct rtw_dev *rtwdev, struct rtw_pci *rtwpci,
@@ -965,8 +1244,14 @@ static void rtw_pci_rx_isr(struct rtw_dev *rtwdev, struct rtw_pci *rtwpci,
 	else
 		count = ring->r.len - (ring->r.wp - cur_wp);
 
+	rtw_rx_ring_occupancy(rtwdev, count, ring->r.len);
+
 	cur_rp = ring->r.rp;
 	while (count--) {
+		/* ring is going to be re-seeded by the recovery work */
+		if (rtwpci->rx_rcvy.state != RTW_PCI_RX_NORMAL)
+			break;
+
 		rtw_pci_dma_check(rtwdev, ring, cur_rp);
 		skb = ring->buf[cur_rp];
 		dma = *((dma_addr_t *)skb->cb);
@@ -1011,6 +1296,10 @@ next_rp:
 			cur_rp = 0;
 	}
 
+	/* frames are still coming in, RDU alone is not a stall */
+	if (cur_rp != ring->r.rp)
+		rtwpci->rx_rcvy.stall_cnt = 0;
+
 	ring->r.rp = cur_rp;
 	ring->r.wp = cur_wp;
 	rtw_write16(rtwdev, RTK_PCI_RXBD_IDX_MPDUQ, ring->r.rp);
@@ -1065,6 +1354,16 @@ static irqreturn_t rtw_pci_interrupt_handler(int irq, void *dev)
 		rtw_pci_tx_isr(rtwdev, rtwpci, RTW_TX_QUEUE_H2C);
 	if (irq_status[0] & IMR_ROK)
 		rtw_pci_rx_isr(rtwdev, rtwpci, RTW_RX_QUEUE_MPDU);
+	if (irq_status[0] & IMR_CPWM)
+		complete(&rtwpci->cpwm_done);
+	if (irq_status[0] & IMR_RDU) {
+		rtwpci->rx_rcvy.rdu_cnt++;
+		rtw_pci_rx_stall_check(rtwdev, rtwpci);
+	}
+	if (irq_status[1] & IMR_RXFOVW) {
+		rtwpci->rx_rcvy.rxfovw_cnt++;
+		rtw_pci_rx_stall_check(rtwdev, rtwpci);
+	}
 
 	rtw_pci_enable_interrupt(rtwdev, rtwpci);
 
@@ -1356,12 +1655,15 @@ static struct rtw_hci_ops rtw_pci_ops = {
 	.start = rtw_pci_start,
 	.stop = rtw_pci_stop,
 	.deep_ps = rtw_pci_deep_ps,
+	.flush_queues = rtw_pci_flush_queues,
 
 	.read8 = rtw_pci_read8,
 	.read16 = rtw_pci_read16,
 	.read32 = rtw_pci_read32,
 	.write8 = rtw_pci_write8,
 	.write16 = rtw_pci_write16,
+	.write_block32 = rtw_pci_write_block32,
+	.write_batch = rtw_pci_write_batch,
 	.write32 = rtw_pci_write32,
 	.write_data_rsvd_page = rtw_pci_write_data_rsvd_page,
 	.write_data_h2c = rtw_pci_write_data_h2c,
@@ -1498,6 +1800,7 @@ static void rtw_pci_remove(struct pci_dev *pdev)
 
 	rtw_unregister_hw(rtwdev, hw);
 	rtw_pci_disable_interrupt(rtwdev, rtwpci);
+	cancel_work_sync(&rtwpci->rx_rcvy.work);
 	rtw_pci_destroy(rtwdev, pdev);
 	rtw_pci_declaim(rtwdev, pdev);
 	rtw_pci_free_irq(rtwdev, pdev);
@@ -64,6 +64,8 @@
 
 #define BIT_CLR_H2CQ_HOST_IDX	BIT(16)
 #define BIT_CLR_H2CQ_HW_IDX	BIT(8)
+#define BIT_CLR_RXQ_HW_IDX	BIT(16)
+#define BIT_CLR_RXQ_HOST_IDX	BIT(0)
 
 #define RTK_PCI_HIMR0		0x0B0
 #define RTK_PCI_HISR0		0x0B4
@@ -196,6 +198,39 @@ struct rtw_pci_rx_ring {
 
 #define RX_TAG_MAX	8192
 
+/* consecutive rx tag mismatch to consider rx dma stalled */
+#define RTW_PCI_RX_TAG_ERR_THRES	8
+/* RDU/RXFOVW interrupts without any rx frame handled, and lasting at least
+ * RTW_PCI_RX_STALL_PERIOD, to reset rx dma
+ */
+#define RTW_PCI_RX_STALL_THRES		32
+#define RTW_PCI_RX_STALL_PERIOD		HZ
+
+#define RTW_PCI_CPWM_TIMEOUT		msecs_to_jiffies(20)
+#define RTW_PCI_FLUSH_TIMEOUT		msecs_to_jiffies(500)
+
+enum rtw_pci_rx_state {
+	RTW_PCI_RX_NORMAL,
+	RTW_PCI_RX_RECOVERING,
+};
+
+struct rtw_pci_rx_recovery {
+	struct work_struct work;
+	enum rtw_pci_rx_state state;
+
+	u32 tag_err;
+	/* hardware rx tag is not reset along with the rx ring */
+	bool tag_resync;
+	u32 stall_cnt;
+	unsigned long stall_start;
+
+	/* event counters, never reset */
+	u32 tag_mismatch_cnt;
+	u32 rdu_cnt;
+	u32 rxfovw_cnt;
+	u32 recover_cnt;
+};
+
 struct rtw_pci {
 	struct pci_dev *pdev;
 
@@ -206,8 +241,16 @@ struct rtw_pci {
 	bool msi_enabled;
 
 	u16 rx_tag;
+	struct rtw_pci_rx_recovery rx_rcvy;
 	struct rtw_pci_tx_ring tx_rings[RTK_MAX_TX_QUEUE_NUM];
 	struct rtw_pci_rx_ring rx_rings[RTK_MAX_RX_QUEUE_NUM];
+	/* woken up when tx rings are reclaimed */
+	wait_queue_head_t tx_flush_wq;
+	/* deep PS leave requested, waiting for CPWM interrupt */
+	struct completion cpwm_done;
+	bool cpwm_waking;
+	u8 cpwm_confirm;
+	ktime_t cpwm_start;
 
 	void __iomem *mmap;
 };
@@ -3,6 +3,7 @@
  */
 
 #include <linux/bcd.h>
+#include <linux/once.h>
 
 #include "main.h"
 #include "reg.h"
@@ -29,6 +30,9 @@ struct phy_pg_cfg_pair {
 	u32 data;
 };
 
+#define RTW_PHY_DB_MAX		96
+#define RTW_PHY_DB_TBL_SIZE	101
+
 static const u32 db_invert_table[12][8] = {
 	{10,		13,		16,		20,
 	 25,		32,		40,		50},
@@ -56,6 +60,16 @@ static const u32 db_invert_table[12][8] = {
 	 1995262315,	2511886432U,	3162277660U,	3981071706U}
 };
 
+/* Built from db_invert_table by rtw_phy_db_tbl_init(), so the conversions
+ * below stay bit-exact with it, including its 1000000 entry at 70dB and the
+ * unscaled 1~24dB entries. rtw_phy_db_linear_tbl[dB] is the linear power of
+ * dB, rtw_phy_db_bound_tbl[dB - 1] is the smallest linear power rounded to
+ * dB, and rtw_phy_rssi_tbl[dB] is the single path rssi of dB.
+ */
+static u64 rtw_phy_db_linear_tbl[RTW_PHY_DB_TBL_SIZE] __read_mostly;
+static u32 rtw_phy_db_bound_tbl[RTW_PHY_DB_MAX] __read_mostly;
+static u8 rtw_phy_rssi_tbl[RTW_PHY_DB_TBL_SIZE] __read_mostly;
+
 u8 rtw_cck_rates[] = { DESC_RATE1M, DESC_RATE2M, DESC_RATE5_5M, DESC_RATE11M };
 u8 rtw_ofdm_rates[] = {
 	DESC_RATE6M,  DESC_RATE9M,  DESC_RATE12M,
@@ -238,10 +252,32 @@ static void rtw_phy_stat_rate_cnt(struct rtw_dev *rtwdev)
 static void rtw_phy_statistics(struct rtw_dev *rtwdev)
 {
 	rtw_phy_stat_rssi(rtwdev);
-	rtw_phy_stat_false_alarm(rtwdev);
 	rtw_phy_stat_rate_cnt(rtwdev);
 }
 
+#define RTW_DM_FA_WINDOW_MS	2000
+
+/* DIG and CCK PD thresholds are tuned for false alarms counted over the
+ * watchdog period, scale the counters read by the faster dm engine up to it
+ */
+static void rtw_phy_stat_fa_normalize(struct rtw_dev *rtwdev)
+{
+	struct rtw_dm_engine *engine = &rtwdev->dm_engine;
+	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+	ktime_t now = ktime_get();
+	s64 ms = ktime_ms_delta(now, engine->last_fa);
+
+	engine->last_fa = now;
+
+	if (!engine->enabled || ms <= 0 || ms >= RTW_DM_FA_WINDOW_MS)
+		return;
+
+	dm_info->cck_fa_cnt = mult_frac(dm_info->cck_fa_cnt,
+					RTW_DM_FA_WINDOW_MS, (u32)ms);
+	dm_info->total_fa_cnt = mult_frac(dm_info->total_fa_cnt,
+					  RTW_DM_FA_WINDOW_MS, (u32)ms);
+}
+
 #define DIG_PERF_FA_TH_LOW			250
 #define DIG_PERF_FA_TH_HIGH			500
 #define DIG_PERF_FA_TH_EXTRA_HIGH		750
@@ -553,15 +589,137 @@ static void rtw_phy_cck_pd(struct rtw_dev *rtwdev)
 		chip->ops->cck_pd_set(rtwdev, level);
 }
 
+#define RTW_DIG_STABLE_CNT	3
+
+static void rtw_phy_dig_trace(struct rtw_dev *rtwdev, u8 pre_igi)
+{
+	struct rtw_dm_engine *engine = &rtwdev->dm_engine;
+	u8 igi = rtwdev->dm_info.igi_history[0];
+	u32 ms;
+
+	if (igi != pre_igi) {
+		if (!engine->converging) {
+			engine->converging = true;
+			engine->conv_start_igi = pre_igi;
+			engine->conv_steps = 0;
+			engine->conv_start = ktime_get();
+		}
+		engine->conv_last_step = ktime_get();
+		engine->conv_steps++;
+		engine->stable_cnt = 0;
+		return;
+	}
+
+	if (!engine->converging || ++engine->stable_cnt < RTW_DIG_STABLE_CNT)
+		return;
+
+	ms = ktime_ms_delta(engine->conv_last_step, engine->conv_start);
+	engine->converging = false;
+	engine->conv_cnt++;
+	engine->conv_last_ms = ms;
+	engine->conv_max_ms = max(engine->conv_max_ms, ms);
+	engine->conv_total_ms += ms;
+
+	rtw_dbg(rtwdev, RTW_DBG_PHY,
+		"IGI 0x%02x -> 0x%02x converged in %u ms, %u steps\n",
+		engine->conv_start_igi, igi, ms, engine->conv_steps);
+}
+
+static void rtw_phy_dm_fast(struct rtw_dev *rtwdev)
+{
+	u8 pre_igi = rtwdev->dm_info.igi_history[0];
+
+	rtw_phy_stat_false_alarm(rtwdev);
+	rtw_phy_stat_fa_normalize(rtwdev);
+	rtw_phy_dig(rtwdev);
+	rtw_phy_cck_pd(rtwdev);
+	rtw_phy_dig_trace(rtwdev, pre_igi);
+}
+
 void rtw_phy_dynamic_mechanism(struct rtw_dev *rtwdev)
 {
+	mutex_lock(&rtwdev->dm_mutex);
+
 	/* for further calculation */
 	rtw_phy_statistics(rtwdev);
-	rtw_phy_dig(rtwdev);
-	rtw_phy_cck_pd(rtwdev);
+	if (!rtwdev->dm_engine.enabled)
+		rtw_phy_dm_fast(rtwdev);
 	rtw_phy_ra_info_update(rtwdev);
 	rtw_phy_dpk_track(rtwdev);
 	rtwdev->chip->ops->pwrtrack_check(rtwdev);
+
+	mutex_unlock(&rtwdev->dm_mutex);
+}
+
+/* false alarm statistics, DIG and CCK PD, every rtw_dm_period_ms under busy
+ * traffic and backed off to the watchdog period when idle. It does not take
+ * rtwdev->mutex, and skips the round instead of leaving LPS.
+ */
+static void rtw_phy_dm_engine_work(struct work_struct *work)
+{
+	struct rtw_dev *rtwdev = container_of(work, struct rtw_dev,
+					      dm_engine.work.work);
+	struct rtw_dm_engine *engine = &rtwdev->dm_engine;
+	bool busy = test_bit(RTW_FLAG_BUSY_TRAFFIC, rtwdev->flags);
+
+	mutex_lock(&rtwdev->dm_mutex);
+
+	/* stopped for WoW and restarted by rtw_wow_resume_start() */
+	if (!test_bit(RTW_FLAG_RUNNING, rtwdev->flags) ||
+	    rtwdev->wow.suspend_mode != RTW_SUSPEND_IDLE)
+		goto unlock;
+
+	if (test_bit(RTW_FLAG_LEISURE_PS, rtwdev->flags) ||
+	    test_bit(RTW_FLAG_LEISURE_PS_DEEP, rtwdev->flags) ||
+	    test_bit(RTW_FLAG_SCANNING, rtwdev->flags)) {
+		engine->skip_cnt++;
+		busy = false;
+	} else {
+		engine->run_cnt++;
+		rtw_phy_dm_fast(rtwdev);
+	}
+
+	if (busy)
+		engine->period_ms = clamp_t(u32, rtw_dm_period_ms ?:
+					    RTW_DM_PERIOD_MAX_MS,
+					    RTW_DM_PERIOD_MIN_MS,
+					    RTW_DM_PERIOD_MAX_MS);
+	else
+		engine->period_ms = min_t(u32, engine->period_ms * 2,
+					  RTW_DM_PERIOD_MAX_MS);
+
+	ieee80211_queue_delayed_work(rtwdev->hw, &engine->work,
+				     msecs_to_jiffies(engine->period_ms));
+
+unlock:
+	mutex_unlock(&rtwdev->dm_mutex);
+}
+
+void rtw_phy_dm_engine_init(struct rtw_dev *rtwdev)
+{
+	INIT_DELAYED_WORK(&rtwdev->dm_engine.work, rtw_phy_dm_engine_work);
+}
+
+void rtw_phy_dm_engine_start(struct rtw_dev *rtwdev)
+{
+	struct rtw_dm_engine *engine = &rtwdev->dm_engine;
+
+	mutex_lock(&rtwdev->dm_mutex);
+	engine->enabled = !!rtw_dm_period_ms;
+	engine->period_ms = clamp_t(u32, rtw_dm_period_ms, RTW_DM_PERIOD_MIN_MS,
+				    RTW_DM_PERIOD_MAX_MS);
+	engine->last_fa = 0;
+	engine->converging = false;
+	mutex_unlock(&rtwdev->dm_mutex);
+
+	if (engine->enabled)
+		ieee80211_queue_delayed_work(rtwdev->hw, &engine->work,
+					     msecs_to_jiffies(engine->period_ms));
+}
+
+void rtw_phy_dm_engine_stop(struct rtw_dev *rtwdev)
+{
+	cancel_delayed_work_sync(&rtwdev->dm_engine.work);
 }
 
 #define FRAC_BITS 3
@@ -596,7 +754,10 @@ static u64 rtw_phy_db_2_linear(u8 power_db)
 	return linear;
 }
 
-static u8 rtw_phy_linear_2_db(u64 linear)
+/* reference conversion walking db_invert_table, only used to build the
+ * lookup tables
+ */
+static u8 rtw_phy_db_invert_2_db(u64 linear)
 {
 	u8 i;
 	u8 j;
@@ -648,35 +809,81 @@ end:
 	return dB;
 }
 
+static void rtw_phy_db_tbl_build(void)
+{
+	u64 linear, lo, hi, mid;
+	u8 db;
+
+	for (db = 0; db < RTW_PHY_DB_TBL_SIZE; db++) {
+		linear = rtw_phy_db_2_linear(db);
+		rtw_phy_db_linear_tbl[db] = linear;
+		linear = (linear + (1 << (FRAC_BITS - 1))) >> FRAC_BITS;
+		rtw_phy_rssi_tbl[db] = rtw_phy_db_invert_2_db(linear);
+	}
+
+	/* the reference conversion is non-decreasing, search the first
+	 * linear power converted to at least dB
+	 */
+	for (db = 1; db <= RTW_PHY_DB_MAX; db++) {
+		lo = 0;
+		hi = db_invert_table[11][7];
+		while (lo < hi) {
+			mid = lo + ((hi - lo) >> 1);
+			if (rtw_phy_db_invert_2_db(mid) >= db)
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		rtw_phy_db_bound_tbl[db - 1] = lo;
+	}
+}
+
+void rtw_phy_db_tbl_init(void)
+{
+	DO_ONCE(rtw_phy_db_tbl_build);
+}
+
+static u8 rtw_phy_linear_2_db(u64 linear)
+{
+	u8 db = 0;
+	u8 step;
+
+	for (step = 64; step; step >>= 1) {
+		if (db + step <= RTW_PHY_DB_MAX &&
+		    linear >= rtw_phy_db_bound_tbl[db + step - 1])
+			db += step;
+	}
+
+	return db;
+}
+
+/* averaging factor of the linear power sum, indexed by path_num */
+static const struct {
+	u8 mul;
+	u8 shift;
+} rtw_phy_path_avg[] = {
+	[0] = {1, 0},
+	[1] = {1, 0},
+	[2] = {1, 1},
+	[3] = {11, 5},
+	[4] = {1, 2},
+};
+
 u8 rtw_phy_rf_power_2_rssi(s8 *rf_power, u8 path_num)
 {
-	s8 power;
-	u8 power_db;
-	u64 linear;
 	u64 sum = 0;
 	u8 path;
+	u8 avg;
 
-	for (path = 0; path < path_num; path++) {
-		power = rf_power[path];
-		power_db = rtw_phy_power_2_db(power);
-		linear = rtw_phy_db_2_linear(power_db);
-		sum += linear;
-	}
+	if (path_num == 1)
+		return rtw_phy_rssi_tbl[rtw_phy_power_2_db(rf_power[0])];
+
+	for (path = 0; path < path_num; path++)
+		sum += rtw_phy_db_linear_tbl[rtw_phy_power_2_db(rf_power[path])];
 
 	sum = (sum + (1 << (FRAC_BITS - 1))) >> FRAC_BITS;
-	switch (path_num) {
-	case 2:
-		sum >>= 1;
-		break;
-	case 3:
-		sum = ((sum) + ((sum) << 1) + ((sum) << 3)) >> 5;
-		break;
-	case 4:
-		sum >>= 2;
-		break;
-	default:
-		break;
-	}
+	avg = path_num < ARRAY_SIZE(rtw_phy_path_avg) ? path_num : 0;
+	sum = (sum * rtw_phy_path_avg[avg].mul) >> rtw_phy_path_avg[avg].shift;
 
 	return rtw_phy_linear_2_db(sum);
 }
@@ -824,6 +1031,98 @@ bool rtw_phy_write_rf_reg_mix(struct rtw_dev *rtwdev, enum rtw_rf_path rf_path,
 	return rtw_phy_write_rf_reg_sipi(rtwdev, rf_path, addr, mask, data);
 }
 
+static bool rtw_rf_shadow_cacheable(struct rtw_dev *rtwdev,
+				    enum rtw_rf_path rf_path, u32 addr)
+{
+	return rf_path < RTW_RF_PATH_MAX &&
+	       !test_bit(addr, rtwdev->rf_shadow.volatile_map);
+}
+
+/* called with rf_lock held, non-volatile registers written with full mask
+ * before are returned without the SIPI/direct read of the hardware
+ */
+u32 rtw_rf_shadow_read(struct rtw_dev *rtwdev, enum rtw_rf_path rf_path,
+		       u32 addr, u32 mask)
+{
+	struct rtw_rf_shadow *shadow = &rtwdev->rf_shadow;
+
+	lockdep_assert_held(&rtwdev->rf_lock);
+
+	addr &= 0xff;
+	if (rtw_rf_shadow_cacheable(rtwdev, rf_path, addr) &&
+	    test_bit(addr, shadow->valid[rf_path])) {
+		shadow->hit_cnt++;
+		return (shadow->val[rf_path][addr] & mask) >> __ffs(mask);
+	}
+
+	shadow->miss_cnt++;
+
+	return rtwdev->chip->ops->read_rf(rtwdev, rf_path, addr, mask);
+}
+
+/* called with rf_lock held, partial writes to a cached register are merged
+ * here so that write_rf does not need to read the register back
+ */
+void rtw_rf_shadow_write(struct rtw_dev *rtwdev, enum rtw_rf_path rf_path,
+			 u32 addr, u32 mask, u32 data)
+{
+	struct rtw_rf_shadow *shadow = &rtwdev->rf_shadow;
+	struct rtw_chip_ops *ops = rtwdev->chip->ops;
+
+	lockdep_assert_held(&rtwdev->rf_lock);
+
+	addr &= 0xff;
+	mask &= RFREG_MASK;
+
+	if (!rtw_rf_shadow_cacheable(rtwdev, rf_path, addr)) {
+		ops->write_rf(rtwdev, rf_path, addr, mask, data);
+		return;
+	}
+
+	if (mask != RFREG_MASK) {
+		if (!test_bit(addr, shadow->valid[rf_path])) {
+			shadow->rmw_miss_cnt++;
+			ops->write_rf(rtwdev, rf_path, addr, mask, data);
+			return;
+		}
+
+		shadow->rmw_hit_cnt++;
+		data = (shadow->val[rf_path][addr] & ~mask) |
+		       ((data << __ffs(mask)) & mask);
+	}
+
+	if (!ops->write_rf(rtwdev, rf_path, addr, RFREG_MASK, data)) {
+		__clear_bit(addr, shadow->valid[rf_path]);
+		return;
+	}
+
+	shadow->val[rf_path][addr] = data & RFREG_MASK;
+	__set_bit(addr, shadow->valid[rf_path]);
+}
+
+/* RF registers are lost on power off and may be changed by firmware */
+void rtw_rf_shadow_invalidate(struct rtw_dev *rtwdev)
+{
+	struct rtw_rf_shadow *shadow = &rtwdev->rf_shadow;
+	unsigned long flags;
+	u8 path;
+
+	spin_lock_irqsave(&rtwdev->rf_lock, flags);
+	for (path = 0; path < RTW_RF_PATH_MAX; path++)
+		bitmap_zero(shadow->valid[path], RTW_RF_SHADOW_SIZE);
+	spin_unlock_irqrestore(&rtwdev->rf_lock, flags);
+}
+
+void rtw_rf_shadow_init(struct rtw_dev *rtwdev)
+{
+	struct rtw_chip_info *chip = rtwdev->chip;
+	struct rtw_rf_shadow *shadow = &rtwdev->rf_shadow;
+	u8 i;
+
+	for (i = 0; i < chip->rf_volatile_num; i++)
+		__set_bit(chip->rf_volatile_regs[i], shadow->volatile_map);
+}
+
 void rtw_phy_setup_phy_cond(struct rtw_dev *rtwdev, u32 pkg)
 {
 	struct rtw_hal *hal = &rtwdev->hal;
@@ -873,7 +1172,67 @@ static bool check_positive(struct rtw_dev *rtwdev, struct rtw_phy_cond cond)
 	return true;
 }
 
-void rtw_parse_tbl_phy_cond(struct rtw_dev *rtwdev, const struct rtw_table *tbl)
+static void rtw_phy_tbl_cmd_set(const struct rtw_table *tbl,
+				struct rtw_phy_tbl_cmd *cmd, u32 addr, u32 data)
+{
+	cmd->addr = addr;
+	cmd->data = data;
+	cmd->op = RTW_PHY_OP_CFG;
+
+	/* same decoding as the rtw_phy_cfg_*() callbacks */
+	if (tbl->do_cfg == rtw_phy_cfg_mac) {
+		cmd->op = RTW_PHY_OP_WRITE8;
+	} else if (tbl->do_cfg == rtw_phy_cfg_agc) {
+		cmd->op = RTW_PHY_OP_WRITE32;
+	} else if (tbl->do_cfg == rtw_phy_cfg_bb) {
+		switch (addr) {
+		case 0xfe:
+			cmd->op = RTW_PHY_OP_MSLEEP;
+			cmd->data = 50;
+			break;
+		case 0xfd:
+			cmd->op = RTW_PHY_OP_MDELAY;
+			cmd->data = 5;
+			break;
+		case 0xfc:
+			cmd->op = RTW_PHY_OP_MDELAY;
+			cmd->data = 1;
+			break;
+		case 0xfb:
+			cmd->op = RTW_PHY_OP_USLEEP;
+			cmd->data = 50;
+			break;
+		case 0xfa:
+			cmd->op = RTW_PHY_OP_UDELAY;
+			cmd->data = 5;
+			break;
+		case 0xf9:
+			cmd->op = RTW_PHY_OP_UDELAY;
+			cmd->data = 1;
+			break;
+		default:
+			cmd->op = RTW_PHY_OP_WRITE32;
+			break;
+		}
+	} else if (tbl->do_cfg == rtw_phy_cfg_rf) {
+		if (addr == 0xffe) {
+			cmd->op = RTW_PHY_OP_MSLEEP;
+			cmd->data = 50;
+		} else if (addr == 0xfe) {
+			cmd->op = RTW_PHY_OP_USLEEP;
+			cmd->data = 100;
+		} else {
+			cmd->op = RTW_PHY_OP_WRITE_RF;
+		}
+	}
+}
+
+/* walk the condition tiles, matched pairs are configured, or recorded into
+ * @prog if given (only counted if prog->cmds is not allocated yet)
+ */
+static void __rtw_parse_tbl_phy_cond(struct rtw_dev *rtwdev,
+				     const struct rtw_table *tbl,
+				     struct rtw_phy_tbl_prog *prog)
 {
 	const union phy_table_tile *p = tbl->data;
 	const union phy_table_tile *end = p + tbl->size / 2;
@@ -911,9 +1270,234 @@ void rtw_parse_tbl_phy_cond(struct rtw_dev *rtwdev, const struct rtw_table *tbl)
 				is_matched = false;
 			}
 		} else if (is_matched) {
-			(*tbl->do_cfg)(rtwdev, tbl, p->cfg.addr, p->cfg.data);
+			if (!prog)
+				(*tbl->do_cfg)(rtwdev, tbl, p->cfg.addr,
+					       p->cfg.data);
+			else if (prog->cmds)
+				rtw_phy_tbl_cmd_set(tbl, &prog->cmds[prog->num++],
+						    p->cfg.addr, p->cfg.data);
+			else
+				prog->num++;
+		}
+	}
+}
+
+static void rtw_phy_tbl_replay(struct rtw_dev *rtwdev,
+			       const struct rtw_phy_tbl_prog *prog)
+{
+	struct rtw_phy_tbl_cache *cache = &rtwdev->phy_tbl;
+	const struct rtw_table *tbl = prog->tbl;
+	const struct rtw_phy_tbl_cmd *cmd = prog->cmds;
+	const struct rtw_phy_tbl_cmd *end = cmd + prog->num;
+
+	for (; cmd < end; cmd++) {
+		switch (cmd->op) {
+		case RTW_PHY_OP_WRITE_BATCH:
+			rtw_write_batch(rtwdev, &prog->writes[cmd->addr],
+					cmd->data);
+			cache->reg_write_cnt += cmd->data;
+			cache->batch_cnt++;
+			break;
+		case RTW_PHY_OP_WRITE8:
+			rtw_write8(rtwdev, cmd->addr, cmd->data);
+			break;
+		case RTW_PHY_OP_WRITE32:
+			rtw_write32(rtwdev, cmd->addr, cmd->data);
+			break;
+		case RTW_PHY_OP_WRITE_RF:
+			rtw_write_rf(rtwdev, tbl->rf_path, cmd->addr,
+				     RFREG_MASK, cmd->data);
+			udelay(1);
+			cache->rf_write_cnt++;
+			break;
+		case RTW_PHY_OP_UDELAY:
+			udelay(cmd->data);
+			break;
+		case RTW_PHY_OP_USLEEP:
+			usleep_range(cmd->data, cmd->data + 10);
+			break;
+		case RTW_PHY_OP_MDELAY:
+			mdelay(cmd->data);
+			break;
+		case RTW_PHY_OP_MSLEEP:
+			msleep(cmd->data);
+			break;
+		case RTW_PHY_OP_CFG:
+		default:
+			(*tbl->do_cfg)(rtwdev, tbl, cmd->addr, cmd->data);
+			break;
+		}
+	}
+}
+
+static struct rtw_phy_tbl_prog *
+rtw_phy_tbl_prog_find(struct rtw_dev *rtwdev, const struct rtw_table *tbl)
+{
+	struct rtw_phy_tbl_cache *cache = &rtwdev->phy_tbl;
+	u8 i;
+
+	for (i = 0; i < cache->prog_num; i++)
+		if (cache->prog[i].tbl == tbl)
+			return &cache->prog[i];
+
+	return NULL;
+}
+
+void rtw_parse_tbl_phy_cond(struct rtw_dev *rtwdev, const struct rtw_table *tbl)
+{
+	struct rtw_phy_tbl_prog *prog;
+
+	prog = rtw_phy_tbl_prog_find(rtwdev, tbl);
+	if (prog && rtw_phy_tbl_precompile) {
+		rtw_phy_tbl_replay(rtwdev, prog);
+		return;
+	}
+
+	__rtw_parse_tbl_phy_cond(rtwdev, tbl, NULL);
+}
+
+static bool rtw_phy_tbl_cmd_is_write(const struct rtw_phy_tbl_cmd *cmd)
+{
+	return cmd->op == RTW_PHY_OP_WRITE8 || cmd->op == RTW_PHY_OP_WRITE32;
+}
+
+/* fold runs of MAC/BB/AGC writes into single RTW_PHY_OP_WRITE_BATCH */
+static int rtw_phy_tbl_batch(struct rtw_phy_tbl_prog *prog)
+{
+	struct rtw_phy_tbl_cmd *cmd, *batch = NULL;
+	struct rtw_backup_info *w;
+	u32 i, n = 0;
+
+	prog->write_num = 0;
+	for (i = 0; i < prog->num; i++)
+		if (rtw_phy_tbl_cmd_is_write(&prog->cmds[i]))
+			prog->write_num++;
+
+	prog->writes = kcalloc(prog->write_num, sizeof(*prog->writes),
+			       GFP_KERNEL);
+	if (!prog->writes)
+		return -ENOMEM;
+
+	/* done in place, at most one command is stored per command read */
+	w = prog->writes;
+	for (i = 0; i < prog->num; i++) {
+		cmd = &prog->cmds[i];
+		if (!rtw_phy_tbl_cmd_is_write(cmd)) {
+			prog->cmds[n++] = *cmd;
+			batch = NULL;
+			continue;
 		}
+
+		w->len = cmd->op == RTW_PHY_OP_WRITE8 ? 1 : 4;
+		w->reg = cmd->addr;
+		w->val = cmd->data;
+
+		if (!batch) {
+			batch = &prog->cmds[n++];
+			batch->op = RTW_PHY_OP_WRITE_BATCH;
+			batch->addr = w - prog->writes;
+			batch->data = 0;
+		}
+		batch->data++;
+		w++;
 	}
+
+	prog->num = n;
+
+	return 0;
+}
+
+static int rtw_phy_tbl_compile(struct rtw_dev *rtwdev,
+			       const struct rtw_table *tbl)
+{
+	struct rtw_phy_tbl_cache *cache = &rtwdev->phy_tbl;
+	struct rtw_phy_tbl_prog *prog;
+	int ret;
+
+	if (!tbl || tbl->parse != rtw_parse_tbl_phy_cond)
+		return 0;
+
+	if (rtw_phy_tbl_prog_find(rtwdev, tbl))
+		return 0;
+
+	if (cache->prog_num >= RTW_PHY_TBL_PROG_NUM)
+		return -ENOSPC;
+
+	prog = &cache->prog[cache->prog_num];
+	prog->num = 0;
+	__rtw_parse_tbl_phy_cond(rtwdev, tbl, prog);
+
+	prog->cmds = kcalloc(prog->num, sizeof(*prog->cmds), GFP_KERNEL);
+	if (!prog->cmds)
+		return -ENOMEM;
+
+	prog->num = 0;
+	__rtw_parse_tbl_phy_cond(rtwdev, tbl, prog);
+
+	ret = rtw_phy_tbl_batch(prog);
+	if (ret) {
+		kfree(prog->cmds);
+		return ret;
+	}
+
+	prog->tbl = tbl;
+
+	cache->prog_num++;
+	cache->tile_num += tbl->size / 2;
+
+	return 0;
+}
+
+/* hal->phy_cond does not change after probe, resolve the conditions of the
+ * tables loaded on every power on once
+ */
+void rtw_phy_compile_tables(struct rtw_dev *rtwdev)
+{
+	struct rtw_chip_info *chip = rtwdev->chip;
+	struct rtw_phy_tbl_cache *cache = &rtwdev->phy_tbl;
+	ktime_t start = ktime_get();
+	u8 rf_path;
+	int ret;
+
+	ret = rtw_phy_tbl_compile(rtwdev, chip->mac_tbl);
+	if (ret)
+		goto err;
+	ret = rtw_phy_tbl_compile(rtwdev, chip->bb_tbl);
+	if (ret)
+		goto err;
+	ret = rtw_phy_tbl_compile(rtwdev, chip->agc_tbl);
+	if (ret)
+		goto err;
+	ret = rtw_phy_tbl_compile(rtwdev, chip->rfk_init_tbl);
+	if (ret)
+		goto err;
+
+	for (rf_path = 0; rf_path < rtwdev->hal.rf_path_num; rf_path++) {
+		ret = rtw_phy_tbl_compile(rtwdev, chip->rf_tbl[rf_path]);
+		if (ret)
+			goto err;
+	}
+
+	cache->compile_us = ktime_us_delta(ktime_get(), start);
+
+	return;
+
+err:
+	/* tables not compiled are still parsed on load */
+	rtw_warn(rtwdev, "failed to precompile phy tables, ret=%d\n", ret);
+}
+
+void rtw_phy_tables_free(struct rtw_dev *rtwdev)
+{
+	struct rtw_phy_tbl_cache *cache = &rtwdev->phy_tbl;
+	u8 i;
+
+	for (i = 0; i < cache->prog_num; i++) {
+		kfree(cache->prog[i].cmds);
+		kfree(cache->prog[i].writes);
+	}
+
+	cache->prog_num = 0;
 }
 
 #define bcd_to_dec_pwr_by_rate(val, i) bcd2bin(val >> (i * 8))
@@ -1579,7 +2163,17 @@ static void rtw_load_rfk_table(struct rtw_dev *rtwdev)
 void rtw_phy_load_tables(struct rtw_dev *rtwdev)
 {
 	struct rtw_chip_info *chip = rtwdev->chip;
+	struct rtw_phy_tbl_cache *cache = &rtwdev->phy_tbl;
+	struct rtw_phy_tbl_load_stat *stat;
+	ktime_t start = ktime_get();
 	u8 rf_path;
+	u32 us;
+
+	cache->reg_write_cnt = 0;
+	cache->batch_cnt = 0;
+	cache->rf_write_cnt = 0;
+	rtw_phy_txagc_invalidate(rtwdev);
+	rtw_set_channel_invalidate(rtwdev);
 
 	rtw_load_table(rtwdev, chip->mac_tbl);
 	rtw_load_table(rtwdev, chip->bb_tbl);
@@ -1592,6 +2186,13 @@ void rtw_phy_load_tables(struct rtw_dev *rtwdev)
 		tbl = chip->rf_tbl[rf_path];
 		rtw_load_table(rtwdev, tbl);
 	}
+
+	us = ktime_us_delta(ktime_get(), start);
+	stat = &cache->load[rtw_phy_tbl_precompile && cache->prog_num];
+	stat->cnt++;
+	stat->last_us = us;
+	stat->max_us = max(stat->max_us, us);
+	stat->total_us += us;
 }
 
 static u8 rtw_get_channel_group(u8 channel)
@@ -1892,11 +2493,18 @@ err:
 	return (s8)rtwdev->chip->max_power_index;
 }
 
+static s8 rtw_phy_get_tx_power_remnant(struct rtw_dev *rtwdev, u8 rate)
+{
+	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+
+	return rate <= DESC_RATE11M ? dm_info->txagc_remnant_cck :
+				      dm_info->txagc_remnant_ofdm;
+}
+
 void rtw_get_tx_power_params(struct rtw_dev *rtwdev, u8 path, u8 rate, u8 bw,
 			     u8 ch, u8 regd, struct rtw_power_params *pwr_param)
 {
 	struct rtw_hal *hal = &rtwdev->hal;
-	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
 	struct rtw_txpwr_idx *pwr_idx;
 	u8 group, band;
 	u8 *base = &pwr_param->pwr_base;
@@ -1925,13 +2533,15 @@ void rtw_get_tx_power_params(struct rtw_dev *rtwdev, u8 path, u8 rate, u8 bw,
 
 	*limit = rtw_phy_get_tx_power_limit(rtwdev, band, bw, path,
 					    rate, ch, regd, sar);
-	*remnant = (rate <= DESC_RATE11M ? dm_info->txagc_remnant_cck :
-		    dm_info->txagc_remnant_ofdm);
+	*remnant = rtw_phy_get_tx_power_remnant(rtwdev, rate);
 }
 
-u8
-rtw_phy_get_tx_power_index(struct rtw_dev *rtwdev, u8 rf_path, u8 rate,
-			   enum rtw_bandwidth bandwidth, u8 channel, u8 regd)
+/* tx power index without the txagc remnant, which is the only part changed
+ * by power tracking and is added by rtw_phy_tx_power_index_add_remnant()
+ */
+static u8
+rtw_phy_get_tx_power_index_raw(struct rtw_dev *rtwdev, u8 rf_path, u8 rate,
+			       enum rtw_bandwidth bandwidth, u8 channel, u8 regd)
 {
 	struct rtw_power_params pwr_param = {0};
 	u8 tx_power;
@@ -1947,7 +2557,13 @@ rtw_phy_get_tx_power_index(struct rtw_dev *rtwdev, u8 rf_path, u8 rate,
 	if (rtwdev->chip->en_dis_dpd)
 		offset += rtw_phy_get_dis_dpd_by_rate_diff(rtwdev, rate);
 
-	tx_power += offset + pwr_param.pwr_remnant;
+	return tx_power + offset;
+}
+
+static u8 rtw_phy_tx_power_index_add_remnant(struct rtw_dev *rtwdev, u8 rate,
+					     u8 tx_power)
+{
+	tx_power += rtw_phy_get_tx_power_remnant(rtwdev, rate);
 
 	if (tx_power > rtwdev->chip->max_power_index)
 		tx_power = rtwdev->chip->max_power_index;
@@ -1955,7 +2571,98 @@ rtw_phy_get_tx_power_index(struct rtw_dev *rtwdev, u8 rf_path, u8 rate,
 	return tx_power;
 }
 
+u8
+rtw_phy_get_tx_power_index(struct rtw_dev *rtwdev, u8 rf_path, u8 rate,
+			   enum rtw_bandwidth bandwidth, u8 channel, u8 regd)
+{
+	u8 tx_power;
+
+	tx_power = rtw_phy_get_tx_power_index_raw(rtwdev, rf_path, rate,
+						  bandwidth, channel, regd);
+
+	return rtw_phy_tx_power_index_add_remnant(rtwdev, rate, tx_power);
+}
+
+static void __rtw_phy_tx_power_cache_invalidate(struct rtw_tx_pwr_cache *cache)
+{
+	int i;
+
+	if (!cache->entry)
+		return;
+
+	for (i = 0; i < RTW_TX_PWR_CACHE_CH_NUM * RTW_CHANNEL_WIDTH_MAX; i++)
+		cache->entry[i].valid = false;
+	cache->flush_cnt++;
+}
+
+/* must be called when any of the tables used by rtw_get_tx_power_params()
+ * except the txagc remnant is changed
+ */
+void rtw_phy_tx_power_cache_invalidate(struct rtw_dev *rtwdev)
+{
+	struct rtw_hal *hal = &rtwdev->hal;
+
+	mutex_lock(&hal->tx_power_mutex);
+	__rtw_phy_tx_power_cache_invalidate(&hal->tx_pwr_cache);
+	mutex_unlock(&hal->tx_power_mutex);
+}
+
+void rtw_phy_tx_power_cache_free(struct rtw_dev *rtwdev)
+{
+	struct rtw_tx_pwr_cache *cache = &rtwdev->hal.tx_pwr_cache;
+
+	kvfree(cache->entry);
+	cache->entry = NULL;
+}
+
+static struct rtw_tx_pwr_cache_entry *
+rtw_phy_tx_power_cache_get(struct rtw_dev *rtwdev, u8 ch, u8 bw, u8 regd)
+{
+	struct rtw_hal *hal = &rtwdev->hal;
+	struct rtw_tx_pwr_cache *cache = &hal->tx_pwr_cache;
+	struct rtw_tx_pwr_cache_entry *entry;
+	u8 band = ch <= 14 ? PHY_BAND_2G : PHY_BAND_5G;
+	int ch_idx;
+
+	lockdep_assert_held(&rtwdev->hal.tx_power_mutex);
+
+	if (bw >= RTW_CHANNEL_WIDTH_MAX)
+		return NULL;
+
+	ch_idx = rtw_channel_to_idx(band, ch);
+	if (ch_idx < 0)
+		return NULL;
+	if (band == PHY_BAND_5G)
+		ch_idx += RTW_MAX_CHANNEL_NUM_2G;
+
+	if (!cache->entry) {
+		cache->entry = kvcalloc(RTW_TX_PWR_CACHE_CH_NUM *
+					RTW_CHANNEL_WIDTH_MAX,
+					sizeof(*cache->entry), GFP_KERNEL);
+		if (!cache->entry)
+			return NULL;
+		cache->regd = regd;
+	}
+
+	if (cache->regd != regd) {
+		__rtw_phy_tx_power_cache_invalidate(cache);
+		cache->regd = regd;
+	}
+
+	/* HT40 ch1+/ch5- or the primaries of an 80M block share the center
+	 * channel but not the limit, recompute when cch_by_bw differs
+	 */
+	entry = &cache->entry[ch_idx * RTW_CHANNEL_WIDTH_MAX + bw];
+	if (memcmp(entry->cch_by_bw, hal->cch_by_bw, sizeof(hal->cch_by_bw))) {
+		memcpy(entry->cch_by_bw, hal->cch_by_bw, sizeof(hal->cch_by_bw));
+		entry->valid = false;
+	}
+
+	return entry;
+}
+
 static void rtw_phy_set_tx_power_index_by_rs(struct rtw_dev *rtwdev,
+					     struct rtw_tx_pwr_cache_entry *entry,
 					     u8 ch, u8 path, u8 rs)
 {
 	struct rtw_hal *hal = &rtwdev->hal;
@@ -1975,8 +2682,19 @@ static void rtw_phy_set_tx_power_index_by_rs(struct rtw_dev *rtwdev,
 	bw = hal->current_band_width;
 	for (i = 0; i < size; i++) {
 		rate = rates[i];
-		pwr_idx = rtw_phy_get_tx_power_index(rtwdev, path, rate,
-						     bw, ch, regd);
+		if (!entry) {
+			pwr_idx = rtw_phy_get_tx_power_index(rtwdev, path, rate,
+							     bw, ch, regd);
+		} else {
+			if (!entry->valid)
+				entry->pwr_idx[path][rate] =
+					rtw_phy_get_tx_power_index_raw(rtwdev,
+								       path,
+								       rate, bw,
+								       ch, regd);
+			pwr_idx = rtw_phy_tx_power_index_add_remnant(rtwdev, rate,
+					entry->pwr_idx[path][rate]);
+		}
 		hal->tx_pwr_tbl[path][rate] = pwr_idx;
 	}
 }
@@ -1987,6 +2705,7 @@ static void rtw_phy_set_tx_power_index_by_rs(struct rtw_dev *rtwdev,
  * write these values into hardware
  */
 static void rtw_phy_set_tx_power_level_by_path(struct rtw_dev *rtwdev,
+					       struct rtw_tx_pwr_cache_entry *entry,
 					       u8 ch, u8 path)
 {
 	struct rtw_hal *hal = &rtwdev->hal;
@@ -1999,24 +2718,153 @@ static void rtw_phy_set_tx_power_level_by_path(struct rtw_dev *rtwdev,
 		rs = RTW_RATE_SECTION_OFDM;
 
 	for (; rs < RTW_RATE_SECTION_MAX; rs++)
-		rtw_phy_set_tx_power_index_by_rs(rtwdev, ch, path, rs);
+		rtw_phy_set_tx_power_index_by_rs(rtwdev, entry, ch, path, rs);
 }
 
 void rtw_phy_set_tx_power_level(struct rtw_dev *rtwdev, u8 channel)
 {
 	struct rtw_chip_info *chip = rtwdev->chip;
 	struct rtw_hal *hal = &rtwdev->hal;
+	struct rtw_tx_pwr_cache_entry *entry;
 	u8 path;
 
 	mutex_lock(&hal->tx_power_mutex);
 
+	entry = rtw_phy_tx_power_cache_get(rtwdev, channel,
+					   hal->current_band_width,
+					   rtwdev->regd.txpwr_regd);
+	if (entry) {
+		if (entry->valid)
+			hal->tx_pwr_cache.hit_cnt++;
+		else
+			hal->tx_pwr_cache.miss_cnt++;
+	}
+
 	for (path = 0; path < hal->rf_path_num; path++)
-		rtw_phy_set_tx_power_level_by_path(rtwdev, channel, path);
+		rtw_phy_set_tx_power_level_by_path(rtwdev, entry, channel, path);
+
+	if (entry)
+		entry->valid = true;
 
 	chip->ops->set_tx_power_index(rtwdev);
 	mutex_unlock(&hal->tx_power_mutex);
 }
 
+static struct rtw_txagc_reg *
+rtw_phy_txagc_find(struct rtw_txagc_reg *regs, u8 num, u32 addr)
+{
+	u8 i;
+
+	for (i = 0; i < num; i++)
+		if (regs[i].addr == addr)
+			return &regs[i];
+
+	return NULL;
+}
+
+/* start collecting tx power index registers for set_tx_power_index */
+void rtw_phy_txagc_begin(struct rtw_dev *rtwdev)
+{
+	struct rtw_txagc_writer *txagc = &rtwdev->hal.txagc;
+
+	lockdep_assert_held(&rtwdev->hal.tx_power_mutex);
+
+	txagc->pend_num = 0;
+	txagc->read_cnt = 0;
+	txagc->write_cnt = 0;
+	txagc->skip_cnt = 0;
+}
+
+/* same as rtw_write32_mask(), but rates sharing a register are merged into
+ * a single write done by rtw_phy_txagc_commit()
+ */
+void rtw_phy_txagc_add(struct rtw_dev *rtwdev, u32 addr, u32 mask, u32 data)
+{
+	struct rtw_txagc_writer *txagc = &rtwdev->hal.txagc;
+	struct rtw_txagc_reg *reg;
+
+	data = (data << __ffs(mask)) & mask;
+
+	reg = rtw_phy_txagc_find(txagc->pend, txagc->pend_num, addr);
+	if (!reg) {
+		if (WARN_ON(txagc->pend_num >= RTW_TXAGC_REG_MAX)) {
+			rtw_write32_mask(rtwdev, addr, mask, data >> __ffs(mask));
+			txagc->read_cnt++;
+			txagc->write_cnt++;
+			return;
+		}
+
+		reg = &txagc->pend[txagc->pend_num++];
+		reg->addr = addr;
+		reg->mask = 0;
+		reg->val = 0;
+	}
+
+	reg->mask |= mask;
+	reg->val = (reg->val & ~mask) | data;
+}
+
+static void rtw_phy_txagc_write(struct rtw_dev *rtwdev,
+				const struct rtw_txagc_reg *reg)
+{
+	struct rtw_txagc_writer *txagc = &rtwdev->hal.txagc;
+	u32 val = reg->val;
+
+	if (reg->mask != MASKDWORD) {
+		val |= rtw_read32(rtwdev, reg->addr) & ~reg->mask;
+		txagc->read_cnt++;
+	}
+
+	rtw_write32(rtwdev, reg->addr, val);
+	txagc->write_cnt++;
+}
+
+void rtw_phy_txagc_commit(struct rtw_dev *rtwdev)
+{
+	struct rtw_txagc_writer *txagc = &rtwdev->hal.txagc;
+	struct rtw_txagc_reg *pend, *last;
+	u8 i;
+
+	for (i = 0; i < txagc->pend_num; i++) {
+		pend = &txagc->pend[i];
+		last = rtw_phy_txagc_find(txagc->last, txagc->last_num,
+					  pend->addr);
+
+		if (last && (last->mask & pend->mask) == pend->mask &&
+		    (last->val & pend->mask) == pend->val) {
+			txagc->skip_cnt++;
+			continue;
+		}
+
+		rtw_phy_txagc_write(rtwdev, pend);
+
+		if (!last) {
+			if (txagc->last_num >= RTW_TXAGC_REG_MAX)
+				continue;
+			last = &txagc->last[txagc->last_num++];
+			last->addr = pend->addr;
+			last->mask = 0;
+			last->val = 0;
+		}
+		last->mask |= pend->mask;
+		last->val = (last->val & ~pend->mask) | pend->val;
+	}
+
+	txagc->pend_num = 0;
+	txagc->set_cnt++;
+	txagc->total_mmio += txagc->read_cnt + txagc->write_cnt;
+}
+
+/* the registers may have been reset or rewritten by the phy tables */
+void rtw_phy_txagc_invalidate(struct rtw_dev *rtwdev)
+{
+	struct rtw_hal *hal = &rtwdev->hal;
+
+	mutex_lock(&hal->tx_power_mutex);
+	hal->txagc.last_num = 0;
+	mutex_unlock(&hal->tx_power_mutex);
+}
+
 static void
 rtw_phy_tx_power_by_rate_config_by_path(struct rtw_hal *hal, u8 path,
 					u8 rs, u8 size, u8 *rates)
@@ -2245,3 +3093,178 @@ bool rtw_phy_pwrtrack_need_iqk(struct rtw_dev *rtwdev)
 	}
 	return false;
 }
+
+/* the registers may have been reset, re-arm the thermal meter and apply
+ * power tracking in full on the next sample
+ */
+void rtw_phy_pwrtrack_invalidate(struct rtw_dev *rtwdev)
+{
+	struct rtw_pwrtrack_info *pt = &rtwdev->dm_info.pwrtrack;
+
+	rtwdev->dm_info.pwrtrack_trigger = false;
+	pt->valid = false;
+	pt->stable_cnt = 0;
+	pt->interval = RTW_PWRTRACK_FAST_TICKS;
+	pt->countdown = 0;
+}
+
+bool rtw_phy_pwrtrack_sample_due(struct rtw_dev *rtwdev)
+{
+	struct rtw_pwrtrack_info *pt = &rtwdev->dm_info.pwrtrack;
+
+	if (pt->countdown) {
+		pt->countdown--;
+		pt->skip_cnt++;
+		return false;
+	}
+
+	return true;
+}
+
+/* Sample the thermal meter every watchdog period after power on and while
+ * the temperature is drifting, and back off once it has been stable.
+ */
+void rtw_phy_pwrtrack_schedule(struct rtw_dev *rtwdev)
+{
+	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+	struct rtw_pwrtrack_info *pt = &dm_info->pwrtrack;
+	bool drift = false;
+	u8 path;
+
+	for (path = 0; path < rtwdev->hal.rf_path_num; path++) {
+		if (dm_info->thermal_avg[path] != pt->thermal_last[path])
+			drift = true;
+		pt->thermal_last[path] = dm_info->thermal_avg[path];
+	}
+
+	if (drift)
+		pt->stable_cnt = 0;
+	else if (pt->stable_cnt < RTW_PWRTRACK_STABLE_CNT)
+		pt->stable_cnt++;
+
+	if (pt->stable_cnt < RTW_PWRTRACK_STABLE_CNT)
+		pt->interval = RTW_PWRTRACK_FAST_TICKS;
+	else
+		pt->interval = RTW_PWRTRACK_SLOW_TICKS;
+
+	pt->countdown = pt->interval - 1;
+	pt->sample_cnt++;
+}
+
+void rtw_phy_pwrtrack_trace(struct rtw_dev *rtwdev, u8 apply)
+{
+	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+	struct rtw_pwrtrack_info *pt = &dm_info->pwrtrack;
+	struct rtw_pwrtrack_trace *trace = &pt->trace[pt->trace_head];
+
+	if (!apply)
+		return;
+
+	trace->time_ms = jiffies_to_msecs(jiffies);
+	trace->apply = apply;
+	memcpy(trace->thermal, dm_info->thermal_avg, sizeof(trace->thermal));
+	memcpy(trace->pwr_idx, dm_info->delta_power_index,
+	       sizeof(trace->pwr_idx));
+
+	pt->trace_head = (pt->trace_head + 1) % RTW_PWRTRACK_TRACE_NUM;
+	pt->trace_cnt++;
+
+	rtw_dbg(rtwdev, RTW_DBG_PHY,
+		"pwrtrack apply 0x%x, thermal %u, pwr idx %d\n",
+		apply, dm_info->thermal_avg[0], dm_info->delta_power_index[0]);
+}
+
+static bool rtw_phy_cali_cache_match(struct rtw_dev *rtwdev,
+				     const struct rtw_cali_cache_entry *entry,
+				     u8 thermal)
+{
+	struct rtw_hal *hal = &rtwdev->hal;
+
+	return entry->valid &&
+	       entry->band == hal->current_band_type &&
+	       entry->ch_group == rtw_get_channel_group(hal->current_channel) &&
+	       entry->bw == hal->current_band_width &&
+	       abs(entry->thermal - thermal) < rtwdev->chip->iqk_threshold;
+}
+
+/* look up a calibration result done on the current channel group and
+ * bandwidth, within iqk_threshold of the current temperature. The thermal
+ * meter is sampled by power tracking, nothing is cached before that.
+ */
+bool rtw_phy_cali_cache_get(struct rtw_dev *rtwdev, s32 *data, u8 num)
+{
+	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+	struct rtw_cali_cache *cache = &dm_info->cali_cache;
+	struct rtw_cali_cache_entry *entry;
+	u8 thermal = dm_info->thermal_avg[0];
+	unsigned long flags;
+	bool hit = false;
+	int i;
+
+	if (!thermal || WARN_ON(num > RTW_CALI_DATA_NUM))
+		return false;
+
+	spin_lock_irqsave(&rtwdev->dm_lock, flags);
+	for (i = 0; i < RTW_CALI_CACHE_NUM; i++) {
+		entry = &cache->entry[i];
+		if (!rtw_phy_cali_cache_match(rtwdev, entry, thermal))
+			continue;
+
+		memcpy(data, entry->data, sizeof(*data) * num);
+		entry->last_use = ++cache->stamp;
+		cache->hit_cnt++;
+		cache->saved_us += entry->cali_us;
+		hit = true;
+		break;
+	}
+	if (!hit)
+		cache->miss_cnt++;
+	spin_unlock_irqrestore(&rtwdev->dm_lock, flags);
+
+	return hit;
+}
+
+void rtw_phy_cali_cache_put(struct rtw_dev *rtwdev, const s32 *data, u8 num,
+			    u32 cali_us)
+{
+	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+	struct rtw_cali_cache *cache = &dm_info->cali_cache;
+	struct rtw_cali_cache_entry *entry, *victim = NULL;
+	struct rtw_hal *hal = &rtwdev->hal;
+	u8 thermal = dm_info->thermal_avg[0];
+	unsigned long flags;
+	int i;
+
+	if (WARN_ON(num > RTW_CALI_DATA_NUM))
+		return;
+
+	spin_lock_irqsave(&rtwdev->dm_lock, flags);
+	cache->cali_us += cali_us;
+
+	if (!thermal)
+		goto unlock;
+
+	/* replace the entry it is a refresh of, or the least recently used */
+	for (i = 0; i < RTW_CALI_CACHE_NUM; i++) {
+		entry = &cache->entry[i];
+		if (rtw_phy_cali_cache_match(rtwdev, entry, thermal)) {
+			victim = entry;
+			break;
+		}
+		if (!victim || !entry->valid ||
+		    (victim->valid && entry->last_use < victim->last_use))
+			victim = entry;
+	}
+
+	victim->valid = true;
+	victim->band = hal->current_band_type;
+	victim->ch_group = rtw_get_channel_group(hal->current_channel);
+	victim->bw = hal->current_band_width;
+	victim->thermal = thermal;
+	victim->last_use = ++cache->stamp;
+	victim->cali_us = cali_us;
+	memcpy(victim->data, data, sizeof(*data) * num);
+
+unlock:
+	spin_unlock_irqrestore(&rtwdev->dm_lock, flags);
+}
@@ -18,6 +18,10 @@ extern u8 rtw_rate_size[];
 
 void rtw_phy_init(struct rtw_dev *rtwdev);
 void rtw_phy_dynamic_mechanism(struct rtw_dev *rtwdev);
+void rtw_phy_dm_engine_init(struct rtw_dev *rtwdev);
+void rtw_phy_dm_engine_start(struct rtw_dev *rtwdev);
+void rtw_phy_dm_engine_stop(struct rtw_dev *rtwdev);
+void rtw_phy_db_tbl_init(void);
 u8 rtw_phy_rf_power_2_rssi(s8 *rf_power, u8 path_num);
 u32 rtw_phy_read_rf(struct rtw_dev *rtwdev, enum rtw_rf_path rf_path,
 		    u32 addr, u32 mask);
@@ -43,10 +47,18 @@ void rtw_phy_cfg_rf(struct rtw_dev *rtwdev, const struct rtw_table *tbl,
 		    u32 addr, u32 data);
 void rtw_phy_init_tx_power(struct rtw_dev *rtwdev);
 void rtw_phy_load_tables(struct rtw_dev *rtwdev);
+void rtw_phy_compile_tables(struct rtw_dev *rtwdev);
+void rtw_phy_tables_free(struct rtw_dev *rtwdev);
 u8
 rtw_phy_get_tx_power_index(struct rtw_dev *rtwdev, u8 rf_path, u8 rate,
 			   enum rtw_bandwidth bandwidth, u8 channel, u8 regd);
 void rtw_phy_set_tx_power_level(struct rtw_dev *rtwdev, u8 channel);
+void rtw_phy_tx_power_cache_invalidate(struct rtw_dev *rtwdev);
+void rtw_phy_tx_power_cache_free(struct rtw_dev *rtwdev);
+void rtw_phy_txagc_begin(struct rtw_dev *rtwdev);
+void rtw_phy_txagc_add(struct rtw_dev *rtwdev, u32 addr, u32 mask, u32 data);
+void rtw_phy_txagc_commit(struct rtw_dev *rtwdev);
+void rtw_phy_txagc_invalidate(struct rtw_dev *rtwdev);
 void rtw_phy_tx_power_by_rate_config(struct rtw_hal *hal);
 void rtw_phy_tx_power_limit_config(struct rtw_hal *hal);
 void rtw_phy_pwrtrack_avg(struct rtw_dev *rtwdev, u8 thermal, u8 path);
@@ -57,6 +69,13 @@ s8 rtw_phy_pwrtrack_get_pwridx(struct rtw_dev *rtwdev,
 			       struct rtw_swing_table *swing_table,
 			       u8 tbl_path, u8 therm_path, u8 delta);
 bool rtw_phy_pwrtrack_need_iqk(struct rtw_dev *rtwdev);
+void rtw_phy_pwrtrack_invalidate(struct rtw_dev *rtwdev);
+bool rtw_phy_pwrtrack_sample_due(struct rtw_dev *rtwdev);
+void rtw_phy_pwrtrack_schedule(struct rtw_dev *rtwdev);
+void rtw_phy_pwrtrack_trace(struct rtw_dev *rtwdev, u8 apply);
+bool rtw_phy_cali_cache_get(struct rtw_dev *rtwdev, s32 *data, u8 num);
+void rtw_phy_cali_cache_put(struct rtw_dev *rtwdev, const s32 *data, u8 num,
+			    u32 cali_us);
 void rtw_phy_config_swing_table(struct rtw_dev *rtwdev,
 				struct rtw_swing_table *swing_table);
 
@@ -2,6 +2,7 @@
 /* Copyright(c) 2018-2019  Realtek Corporation
  */
 
+#include <linux/iopoll.h>
 #include "main.h"
 #include "reg.h"
 #include "fw.h"
@@ -10,6 +11,7 @@
 #include "coex.h"
 #include "debug.h"
 #include "reg.h"
+#include "wow.h"
 
 static int rtw_ips_pwr_up(struct rtw_dev *rtwdev)
 {
@@ -25,13 +27,28 @@ static int rtw_ips_pwr_up(struct rtw_dev *rtwdev)
 	return ret;
 }
 
+static void rtw_ips_bb_on(struct rtw_dev *rtwdev)
+{
+	rtw_core_bb_on(rtwdev);
+	rtw_set_channel(rtwdev);
+	clear_bit(RTW_FLAG_INACTIVE_PS, rtwdev->flags);
+}
+
 int rtw_enter_ips(struct rtw_dev *rtwdev)
 {
+	struct rtw_ips *ips = &rtwdev->ips;
+
 	set_bit(RTW_FLAG_INACTIVE_PS, rtwdev->flags);
 
 	rtw_coex_ips_notify(rtwdev, COEX_IPS_ENTER);
 
-	rtw_core_stop(rtwdev);
+	if (rtw_ips_mode == RTW_IPS_MODE_BB_OFF) {
+		rtw_core_bb_off(rtwdev);
+		ips->enter_cnt[RTW_IPS_MODE_BB_OFF]++;
+	} else {
+		rtw_core_stop(rtwdev);
+		ips->enter_cnt[RTW_IPS_MODE_PWR_OFF]++;
+	}
 
 	return 0;
 }
@@ -48,8 +65,19 @@ static void rtw_restore_port_cfg_iter(void *data, u8 *mac,
 
 int rtw_leave_ips(struct rtw_dev *rtwdev)
 {
+	struct rtw_ips *ips = &rtwdev->ips;
+	ktime_t start = ktime_get();
+	u8 mode;
+	u32 us;
 	int ret;
 
+	if (ips->bb_off) {
+		mode = RTW_IPS_MODE_BB_OFF;
+		rtw_ips_bb_on(rtwdev);
+		goto out;
+	}
+
+	mode = RTW_IPS_MODE_PWR_OFF;
 	ret = rtw_ips_pwr_up(rtwdev);
 	if (ret) {
 		rtw_err(rtwdev, "failed to leave ips state\n");
@@ -58,18 +86,22 @@ int rtw_leave_ips(struct rtw_dev *rtwdev)
 
 	rtw_iterate_vifs_atomic(rtwdev, rtw_restore_port_cfg_iter, rtwdev);
 
+out:
 	rtw_coex_ips_notify(rtwdev, COEX_IPS_LEAVE);
 
+	us = ktime_us_delta(ktime_get(), start);
+	ips->leave_cnt[mode]++;
+	ips->leave_last_us[mode] = us;
+	ips->leave_max_us[mode] = max(ips->leave_max_us[mode], us);
+	ips->leave_total_us[mode] += us;
+
 	return 0;
 }
 
-void rtw_power_mode_change(struct rtw_dev *rtwdev, bool enter)
+static u8 rtw_power_mode_request(struct rtw_dev *rtwdev, bool enter)
 {
-	u8 request, confirm, polling;
-	u8 polling_cnt;
-	u8 retry_cnt = 0;
+	u8 request, confirm;
 
-retry:
 	request = rtw_read8(rtwdev, rtwdev->hci.rpwm_addr);
 	confirm = rtw_read8(rtwdev, rtwdev->hci.cpwm_addr);
 
@@ -85,45 +117,116 @@ retry:
 
 	rtw_write8(rtwdev, rtwdev->hci.rpwm_addr, request);
 
+	return confirm;
+}
+
+static bool rtw_power_mode_acked(struct rtw_dev *rtwdev, u8 confirm)
+{
+	u8 polling = rtw_read8(rtwdev, rtwdev->hci.cpwm_addr);
+
+	return (polling ^ confirm) & BIT_RPWM_TOGGLE;
+}
+
+static void rtw_power_mode_stat(struct rtw_dev *rtwdev, ktime_t start,
+				bool irq)
+{
+	struct rtw_deep_ps_stats *stats = &rtwdev->deep_ps_stats;
+	u32 us = ktime_us_delta(ktime_get(), start);
+	u32 idx = min_t(u32, fls(us), RTW_DEEP_PS_HIST_NUM - 1);
+
+	if (irq)
+		stats->irq_cnt++;
+	else
+		stats->poll_cnt++;
+
+	stats->hist[rtw_fw_lps_deep_mode][idx]++;
+	stats->max_us = max(stats->max_us, us);
+}
+
+/* request firmware to leave deep PS, the returned CPWM value is passed to
+ * rtw_power_mode_leave_confirm() once the ack is expected
+ */
+u8 rtw_power_mode_leave_request(struct rtw_dev *rtwdev)
+{
+	return rtw_power_mode_request(rtwdev, false);
+}
+EXPORT_SYMBOL(rtw_power_mode_leave_request);
+
+/* wait for CPWM to ack the leave, @irq tells the ack has been signalled by
+ * interrupt already so the register is expected to be toggled at first read
+ */
+void rtw_power_mode_leave_confirm(struct rtw_dev *rtwdev, u8 confirm,
+				  ktime_t start, bool irq)
+{
+	struct rtw_deep_ps_stats *stats = &rtwdev->deep_ps_stats;
+	u8 retry_cnt = 0;
+	u8 polling;
+	int ret;
+
+	if (irq && rtw_power_mode_acked(rtwdev, confirm)) {
+		rtw_power_mode_stat(rtwdev, start, true);
+		return;
+	}
+
 	/* check confirm power mode has left power save state */
-	if (!enter) {
-		for (polling_cnt = 0; polling_cnt < 3; polling_cnt++) {
-			polling = rtw_read8(rtwdev, rtwdev->hci.cpwm_addr);
-			if ((polling ^ confirm) & BIT_RPWM_TOGGLE)
-				return;
-			mdelay(20);
+	for (;;) {
+		ret = read_poll_timeout_atomic(rtw_read8, polling,
+					       (polling ^ confirm) &
+					       BIT_RPWM_TOGGLE,
+					       10, RTW_DEEP_PS_LEAVE_TIMEOUT_US,
+					       false, rtwdev,
+					       rtwdev->hci.cpwm_addr);
+		if (!ret) {
+			rtw_power_mode_stat(rtwdev, start, false);
+			return;
 		}
 
 		/* in case of fw/hw missed the request, retry 3 times */
-		if (retry_cnt < 3) {
-			rtw_warn(rtwdev, "failed to leave deep PS, retry=%d\n",
-				 retry_cnt);
-			retry_cnt++;
-			goto retry;
-		}
+		if (retry_cnt >= 3)
+			break;
 
-		/* Hit here means that driver failed to change hardware
-		 * power mode to active state after retry 3 times.
-		 * If the power state is locked at Deep sleep, most of
-		 * the hardware circuits is not working, even register
-		 * read/write. It should be treated as fatal error and
-		 * requires an entire analysis about the firmware/hardware
-		 */
-		WARN_ON("Hardware power state locked\n");
+		rtw_warn(rtwdev, "failed to leave deep PS, retry=%d\n",
+			 retry_cnt);
+		retry_cnt++;
+		stats->retry_cnt++;
+		confirm = rtw_power_mode_request(rtwdev, false);
 	}
+
+	stats->fail_cnt++;
+
+	/* Hit here means that driver failed to change hardware
+	 * power mode to active state after retry 3 times.
+	 * If the power state is locked at Deep sleep, most of
+	 * the hardware circuits is not working, even register
+	 * read/write. It should be treated as fatal error and
+	 * requires an entire analysis about the firmware/hardware
+	 */
+	WARN_ON("Hardware power state locked\n");
+}
+EXPORT_SYMBOL(rtw_power_mode_leave_confirm);
+
+void rtw_power_mode_change(struct rtw_dev *rtwdev, bool enter)
+{
+	ktime_t start = ktime_get();
+	u8 confirm;
+
+	confirm = rtw_power_mode_request(rtwdev, enter);
+	if (!enter)
+		rtw_power_mode_leave_confirm(rtwdev, confirm, start, false);
 }
 EXPORT_SYMBOL(rtw_power_mode_change);
 
 static void __rtw_leave_lps_deep(struct rtw_dev *rtwdev)
 {
 	rtw_hci_deep_ps(rtwdev, false);
+
+	/* send h2c commands held off during deep PS */
+	if (rtwdev->h2c.queue_len)
+		ieee80211_queue_delayed_work(rtwdev->hw, &rtwdev->h2c.work, 0);
 }
 
 static void rtw_fw_leave_lps_state_check(struct rtw_dev *rtwdev)
 {
-#define LEAVE_LPS_TRY_CNT 5
-	int i;
-
 	/* Driver need to wait firmware to leave lps successfully
 	 * by sending null packet to inform AP. If AP gets null
 	 * packet and sends ack, driver will restore REG_TCR Register.
@@ -133,20 +236,28 @@ static void rtw_fw_leave_lps_state_check(struct rtw_dev *rtwdev)
 	 * If REG_TCR Register is still set incorrectly after 100ms,
 	 * we will modify it directly.
 	 */
-	for (i = 0 ; i < LEAVE_LPS_TRY_CNT; i++) {
-		if (rtw_read32_mask(rtwdev, REG_TCR, BIT_PWRMGT_HWDATA_EN) == 0)
-			break;
-		msleep(20);
-	}
-	if (i == LEAVE_LPS_TRY_CNT) {
+	if (rtw_poll32_timeout(rtwdev, REG_TCR, BIT_PWRMGT_HWDATA_EN, 0,
+			       RTW_LEAVE_LPS_TIMEOUT_US)) {
 		rtw_warn(rtwdev, "firmware failed to restore hardware setting\n");
 		rtw_write32_mask(rtwdev, REG_TCR, BIT_PWRMGT_HWDATA_EN, 0);
 	}
 }
 
+static void rtw_lps_ctrl_latency(ktime_t start, u32 *last_us, u32 *max_us,
+				 u64 *total_us)
+{
+	u32 us = ktime_us_delta(ktime_get(), start);
+
+	*last_us = us;
+	*max_us = max(*max_us, us);
+	*total_us += us;
+}
+
 static void rtw_leave_lps_core(struct rtw_dev *rtwdev)
 {
 	struct rtw_lps_conf *conf = &rtwdev->lps_conf;
+	struct rtw_lps_ctrl *ctrl = &rtwdev->lps_ctrl;
+	ktime_t start = ktime_get();
 
 	conf->state = RTW_ALL_ON;
 	conf->awake_interval = 1;
@@ -156,7 +267,15 @@ static void rtw_leave_lps_core(struct rtw_dev *rtwdev)
 	rtw_fw_set_pwr_mode(rtwdev);
 	rtw_fw_leave_lps_state_check(rtwdev);
 
-	clear_bit(RTW_FLAG_LEISURE_PS, rtwdev->flags);
+	/* firmware drives RF while in LPS */
+	rtw_rf_shadow_invalidate(rtwdev);
+
+	if (test_and_clear_bit(RTW_FLAG_LEISURE_PS, rtwdev->flags))
+		ctrl->residency_us += ktime_us_delta(start, ctrl->enter_time);
+
+	ctrl->leave_cnt++;
+	rtw_lps_ctrl_latency(start, &ctrl->leave_last_us, &ctrl->leave_max_us,
+			     &ctrl->leave_total_us);
 
 	rtw_coex_lps_notify(rtwdev, COEX_LPS_DISABLE);
 }
@@ -175,12 +294,27 @@ static void __rtw_enter_lps_deep(struct rtw_dev *rtwdev)
 	if (rtw_fw_lps_deep_mode == LPS_DEEP_MODE_PG)
 		rtw_fw_set_pg_info(rtwdev);
 
+	/* firmware must get SET_PWR_MODE and anything queued with it before
+	 * the sleep request, and nothing can be queued until deep PS is set
+	 */
+	rtw_fw_h2c_queue_flush(rtwdev);
+
+	spin_lock(&rtwdev->h2c.lock);
+	if (rtwdev->h2c.queue_len) {
+		spin_unlock(&rtwdev->h2c.lock);
+		rtw_dbg(rtwdev, RTW_DBG_PS,
+			"H2C queue not empty, cannot enter deep PS\n");
+		return;
+	}
 	rtw_hci_deep_ps(rtwdev, true);
+	spin_unlock(&rtwdev->h2c.lock);
 }
 
 static void rtw_enter_lps_core(struct rtw_dev *rtwdev)
 {
 	struct rtw_lps_conf *conf = &rtwdev->lps_conf;
+	struct rtw_lps_ctrl *ctrl = &rtwdev->lps_ctrl;
+	ktime_t start = ktime_get();
 
 	conf->state = RTW_RF_OFF;
 	conf->awake_interval = 1;
@@ -191,6 +325,12 @@ static void rtw_enter_lps_core(struct rtw_dev *rtwdev)
 
 	rtw_fw_set_pwr_mode(rtwdev);
 	set_bit(RTW_FLAG_LEISURE_PS, rtwdev->flags);
+
+	ctrl->enter_time = ktime_get();
+	ctrl->burst_cnt = 0;
+	ctrl->enter_cnt++;
+	rtw_lps_ctrl_latency(start, &ctrl->enter_last_us, &ctrl->enter_max_us,
+			     &ctrl->enter_total_us);
 }
 
 void rtw_lps_work(struct work_struct *work)
@@ -243,8 +383,11 @@ void rtw_enter_lps(struct rtw_dev *rtwdev, u8 port_id)
 	if (rtwdev->coex.stat.wl_force_lps_ctrl)
 		return;
 
+	/* dm engine must not touch BB once firmware owns RF */
+	mutex_lock(&rtwdev->dm_mutex);
 	__rtw_enter_lps(rtwdev, port_id);
 	__rtw_enter_lps_deep(rtwdev);
+	mutex_unlock(&rtwdev->dm_mutex);
 }
 
 void rtw_leave_lps(struct rtw_dev *rtwdev)
@@ -261,3 +404,164 @@ void rtw_leave_lps_deep(struct rtw_dev *rtwdev)
 
 	__rtw_leave_lps_deep(rtwdev);
 }
+
+struct rtw_lps_iter_data {
+	struct rtw_vif *rtwvif;
+	bool active;
+	u8 assoc_cnt;
+};
+
+static void rtw_lps_vif_iter(void *data, u8 *mac, struct ieee80211_vif *vif)
+{
+	struct rtw_lps_iter_data *iter_data = data;
+
+	/* only STATION mode can enter lps */
+	if (vif->type != NL80211_IFTYPE_STATION) {
+		iter_data->active = true;
+		return;
+	}
+
+	if (vif->bss_conf.assoc) {
+		iter_data->assoc_cnt++;
+		iter_data->rtwvif = (struct rtw_vif *)vif->drv_priv;
+	}
+}
+
+static bool rtw_lps_ctrl_idle(struct rtw_lps_ctrl *ctrl, ktime_t now)
+{
+	ktime_t last = READ_ONCE(ctrl->last_activity);
+
+	return !ktime_before(now, ktime_add_ms(last, rtw_lps_idle_gap_ms));
+}
+
+static void rtw_lps_enter_work(struct work_struct *work)
+{
+	struct rtw_lps_ctrl *ctrl = container_of(work, struct rtw_lps_ctrl,
+						 enter_work);
+	struct rtw_dev *rtwdev = container_of(ctrl, struct rtw_dev, lps_ctrl);
+	struct rtw_lps_iter_data data = {};
+
+	mutex_lock(&rtwdev->mutex);
+
+	if (!test_bit(RTW_FLAG_RUNNING, rtwdev->flags) ||
+	    test_bit(RTW_FLAG_SCANNING, rtwdev->flags) ||
+	    test_bit(RTW_FLAG_LEISURE_PS, rtwdev->flags) ||
+	    rtwdev->wow.suspend_mode != RTW_SUSPEND_IDLE ||
+	    !rtw_fw_support_lps || !rtw_lps_idle_gap_ms)
+		goto unlock;
+
+	/* traffic came in between the timer and the work */
+	if (!rtw_lps_ctrl_idle(ctrl, ktime_get()))
+		goto unlock;
+
+	rtw_iterate_vifs_atomic(rtwdev, rtw_lps_vif_iter, &data);
+
+	/* same rule as watch dog, fw handles only one associated station */
+	if (!data.rtwvif || data.active || data.assoc_cnt != 1)
+		goto unlock;
+
+	rtw_enter_lps(rtwdev, data.rtwvif->port);
+	if (test_bit(RTW_FLAG_LEISURE_PS, rtwdev->flags))
+		ctrl->idle_enter_cnt++;
+
+unlock:
+	mutex_unlock(&rtwdev->mutex);
+}
+
+static void rtw_lps_leave_work(struct work_struct *work)
+{
+	struct rtw_lps_ctrl *ctrl = container_of(work, struct rtw_lps_ctrl,
+						 leave_work);
+	struct rtw_dev *rtwdev = container_of(ctrl, struct rtw_dev, lps_ctrl);
+
+	mutex_lock(&rtwdev->mutex);
+
+	if (!test_bit(RTW_FLAG_RUNNING, rtwdev->flags) ||
+	    !test_bit(RTW_FLAG_LEISURE_PS, rtwdev->flags) ||
+	    rtwdev->wow.suspend_mode != RTW_SUSPEND_IDLE)
+		goto unlock;
+
+	rtw_leave_lps(rtwdev);
+	ctrl->predict_leave_cnt++;
+
+unlock:
+	mutex_unlock(&rtwdev->mutex);
+}
+
+static enum hrtimer_restart rtw_lps_idle_timer(struct hrtimer *timer)
+{
+	struct rtw_lps_ctrl *ctrl = container_of(timer, struct rtw_lps_ctrl,
+						 idle_timer);
+	struct rtw_dev *rtwdev = container_of(ctrl, struct rtw_dev, lps_ctrl);
+	ktime_t last = READ_ONCE(ctrl->last_activity);
+
+	/* traffic after the timer was armed, wait for the rest of the gap */
+	if (!rtw_lps_ctrl_idle(ctrl, ktime_get())) {
+		hrtimer_set_expires(timer, ktime_add_ms(last,
+							rtw_lps_idle_gap_ms));
+		return HRTIMER_RESTART;
+	}
+
+	ieee80211_queue_work(rtwdev->hw, &ctrl->enter_work);
+
+	return HRTIMER_NORESTART;
+}
+
+/* Called for each unicast data frame queued to or received from hardware.
+ * LPS is entered once no traffic is seen for rtw_lps_idle_gap_ms, instead
+ * of waiting for the next watch dog. Voice frames or a burst of frames
+ * within the idle gap while in LPS leave it ahead of the watch dog.
+ */
+void rtw_lps_ctrl_traffic(struct rtw_dev *rtwdev, u8 ac)
+{
+	struct rtw_lps_ctrl *ctrl = &rtwdev->lps_ctrl;
+	ktime_t now = ktime_get();
+
+	if (rtw_lps_ctrl_idle(ctrl, now))
+		ctrl->burst_cnt = 0;
+	ctrl->burst_cnt++;
+	ctrl->ac_cnt[ac]++;
+	WRITE_ONCE(ctrl->last_activity, now);
+
+	if (!rtw_lps_idle_gap_ms)
+		return;
+
+	if (test_bit(RTW_FLAG_LEISURE_PS, rtwdev->flags)) {
+		if (ac == IEEE80211_AC_VO ||
+		    ctrl->burst_cnt > RTW_LPS_THRESHOLD)
+			ieee80211_queue_work(rtwdev->hw, &ctrl->leave_work);
+		return;
+	}
+
+	if (!hrtimer_active(&ctrl->idle_timer))
+		hrtimer_start(&ctrl->idle_timer,
+			      ms_to_ktime(rtw_lps_idle_gap_ms),
+			      HRTIMER_MODE_REL);
+}
+
+void rtw_lps_ctrl_init(struct rtw_dev *rtwdev)
+{
+	struct rtw_lps_ctrl *ctrl = &rtwdev->lps_ctrl;
+
+	hrtimer_init(&ctrl->idle_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	ctrl->idle_timer.function = rtw_lps_idle_timer;
+	INIT_WORK(&ctrl->enter_work, rtw_lps_enter_work);
+	INIT_WORK(&ctrl->leave_work, rtw_lps_leave_work);
+}
+
+void rtw_lps_ctrl_stop(struct rtw_dev *rtwdev)
+{
+	/* the works take rtwdev->mutex held by the caller, they do nothing
+	 * once RTW_FLAG_RUNNING is cleared so leave them queued
+	 */
+	hrtimer_cancel(&rtwdev->lps_ctrl.idle_timer);
+}
+
+void rtw_lps_ctrl_deinit(struct rtw_dev *rtwdev)
+{
+	struct rtw_lps_ctrl *ctrl = &rtwdev->lps_ctrl;
+
+	hrtimer_cancel(&ctrl->idle_timer);
+	cancel_work_sync(&ctrl->enter_work);
+	cancel_work_sync(&ctrl->leave_work);
+}
@@ -6,6 +6,9 @@
 #define __RTW_PS_H_
 
 #define RTW_LPS_THRESHOLD	2
+#define RTW_LPS_IDLE_GAP_MS	100
+#define RTW_LEAVE_LPS_TIMEOUT_US	100000
+#define RTW_DEEP_PS_LEAVE_TIMEOUT_US	60000
 
 #define POWER_MODE_ACK		BIT(6)
 #define POWER_MODE_PG		BIT(4)
@@ -16,8 +19,15 @@ int rtw_leave_ips(struct rtw_dev *rtwdev);
 
 void rtw_lps_work(struct work_struct *work);
 void rtw_power_mode_change(struct rtw_dev *rtwdev, bool enter);
+u8 rtw_power_mode_leave_request(struct rtw_dev *rtwdev);
+void rtw_power_mode_leave_confirm(struct rtw_dev *rtwdev, u8 confirm,
+				  ktime_t start, bool irq);
 void rtw_enter_lps(struct rtw_dev *rtwdev, u8 port_id);
 void rtw_leave_lps(struct rtw_dev *rtwdev);
 void rtw_leave_lps_deep(struct rtw_dev *rtwdev);
+void rtw_lps_ctrl_traffic(struct rtw_dev *rtwdev, u8 ac);
+void rtw_lps_ctrl_init(struct rtw_dev *rtwdev);
+void rtw_lps_ctrl_stop(struct rtw_dev *rtwdev);
+void rtw_lps_ctrl_deinit(struct rtw_dev *rtwdev);
 
 #endif
@@ -138,6 +138,7 @@ static void rtw8723d_pwrtrack_init(struct rtw_dev *rtwdev)
 	dm_info->thermal_meter_k = rtwdev->efuse.thermal_meter_k;
 	dm_info->txagc_remnant_cck = 0;
 	dm_info->txagc_remnant_ofdm = 0;
+	rtw_phy_pwrtrack_invalidate(rtwdev);
 }
 
 static void rtw8723d_phy_set_param(struct rtw_dev *rtwdev)
@@ -507,8 +508,10 @@ static void rtw8723d_set_channel_rf(struct rtw_dev *rtwdev, u8 channel, u8 bw)
 
 	rtw_write_rf(rtwdev, RF_PATH_A, RF_CFGCH, RFREG_MASK, rf_cfgch[0]);
 	rtw_write_rf(rtwdev, RF_PATH_B, RF_CFGCH, RFREG_MASK, rf_cfgch[1]);
+	rtw_set_channel_stage(rtwdev, RTW_CHSW_RF);
 
 	rtw8723d_spur_cal(rtwdev, channel);
+	rtw_set_channel_stage(rtwdev, RTW_CHSW_SPUR);
 }
 
 #define CCK_DFIR_NR	3
@@ -537,6 +540,9 @@ static void rtw8723d_set_channel_bb(struct rtw_dev *rtwdev, u8 channel, u8 bw,
 			channel <= 13 ? cck_dfir_cfg[0] : cck_dfir_cfg[1];
 	int i;
 
+	if (rtwdev->hal.chsw.bw_unchanged)
+		return;
+
 	for (i = 0; i < CCK_DFIR_NR; i++, cck_dfir++)
 		rtw_write32(rtwdev, cck_dfir->reg, cck_dfir->val);
 
@@ -564,7 +570,9 @@ static void rtw8723d_set_channel(struct rtw_dev *rtwdev, u8 channel, u8 bw,
 {
 	rtw8723d_set_channel_rf(rtwdev, channel, bw);
 	rtw_set_channel_mac(rtwdev, channel, bw, primary_chan_idx);
+	rtw_set_channel_stage(rtwdev, RTW_CHSW_MAC);
 	rtw8723d_set_channel_bb(rtwdev, channel, bw, primary_chan_idx);
+	rtw_set_channel_stage(rtwdev, RTW_CHSW_BB);
 }
 
 #define BIT_CFENDFORM		BIT(9)
@@ -637,7 +645,7 @@ rtw8723d_set_tx_power_index_by_rate(struct rtw_dev *rtwdev, u8 path, u8 rs)
 			continue;
 		}
 
-		rtw_write32_mask(rtwdev, txagc->addr, txagc->mask, pwr_index);
+		rtw_phy_txagc_add(rtwdev, txagc->addr, txagc->mask, pwr_index);
 	}
 }
 
@@ -646,10 +654,12 @@ static void rtw8723d_set_tx_power_index(struct rtw_dev *rtwdev)
 	struct rtw_hal *hal = &rtwdev->hal;
 	int rs, path;
 
+	rtw_phy_txagc_begin(rtwdev);
 	for (path = 0; path < hal->rf_path_num; path++) {
 		for (rs = 0; rs <= RTW_RATE_SECTION_HT_1S; rs++)
 			rtw8723d_set_tx_power_index_by_rate(rtwdev, path, rs);
 	}
+	rtw_phy_txagc_commit(rtwdev);
 }
 
 static void rtw8723d_efuse_en(struct rtw_dev *rtwdev, bool enable)
@@ -984,6 +994,9 @@ static void rtw8723d_iqk_one_shot(struct rtw_dev *rtwdev, bool tx,
 	rtw_write32(rtwdev, REG_IQK_AGC_PTS_11N, pts);
 	rtw_write32(rtwdev, REG_IQK_AGC_PTS_11N, 0xf8000000);
 
+	/* IQK busy waits with mdelay() all along, keep it usable from
+	 * atomic context with the atomic poll
+	 */
 	if (!check_hw_ready(rtwdev, REG_IQK_RES_RY, BIT_IQK_DONE, 1))
 		rtw_warn(rtwdev, "%s %s IQK isn't done\n", iqk_cfg->name,
 			 tx ? "TX" : "RX");
@@ -1456,16 +1469,37 @@ void rtw8723d_iqk_one_round(struct rtw_dev *rtwdev, s32 result[][IQK_NR], u8 t,
 		"[IQK] back to BB mode, load original value!\n");
 }
 
-static void rtw8723d_phy_calibration(struct rtw_dev *rtwdev)
+static void rtw8723d_iqk_apply(struct rtw_dev *rtwdev, const s32 result[])
 {
 	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+
+	rtw8723d_iqk_fill_s1_matrix(rtwdev, result);
+	rtw8723d_iqk_fill_s0_matrix(rtwdev, result);
+
+	dm_info->iqk.result.s1_x = result[IQK_S1_TX_X];
+	dm_info->iqk.result.s1_y = result[IQK_S1_TX_Y];
+	dm_info->iqk.result.s0_x = result[IQK_S0_TX_X];
+	dm_info->iqk.result.s0_y = result[IQK_S0_TX_Y];
+	dm_info->iqk.done = true;
+}
+
+static void rtw8723d_phy_calibration(struct rtw_dev *rtwdev)
+{
 	s32 result[IQK_ROUND_SIZE][IQK_NR];
 	struct iqk_backup_regs backup;
 	u8 i, j;
 	u8 final_candidate = IQK_ROUND_INVALID;
+	ktime_t start;
 	bool good;
 
+	if (rtw_phy_cali_cache_get(rtwdev, result[IQK_ROUND_0], IQK_NR)) {
+		rtw_dbg(rtwdev, RTW_DBG_RFK, "[IQK] reload cached result\n");
+		rtw8723d_iqk_apply(rtwdev, result[IQK_ROUND_0]);
+		return;
+	}
+
 	rtw_dbg(rtwdev, RTW_DBG_RFK, "[IQK] Start!!!\n");
+	start = ktime_get();
 
 	memset(result, 0, sizeof(result));
 
@@ -1512,14 +1546,9 @@ static void rtw8723d_phy_calibration(struct rtw_dev *rtwdev)
 	}
 
 iqk_done:
-	rtw8723d_iqk_fill_s1_matrix(rtwdev, result[final_candidate]);
-	rtw8723d_iqk_fill_s0_matrix(rtwdev, result[final_candidate]);
-
-	dm_info->iqk.result.s1_x = result[final_candidate][IQK_S1_TX_X];
-	dm_info->iqk.result.s1_y = result[final_candidate][IQK_S1_TX_Y];
-	dm_info->iqk.result.s0_x = result[final_candidate][IQK_S0_TX_X];
-	dm_info->iqk.result.s0_y = result[final_candidate][IQK_S0_TX_Y];
-	dm_info->iqk.done = true;
+	rtw8723d_iqk_apply(rtwdev, result[final_candidate]);
+	rtw_phy_cali_cache_put(rtwdev, result[final_candidate], IQK_NR,
+			       ktime_us_delta(ktime_get(), start));
 
 out:
 	rtw_write32(rtwdev, REG_BB_SEL_BTG, backup.bb_sel_btg);
@@ -1820,29 +1849,52 @@ static void rtw8723d_set_iqk_matrix(struct rtw_dev *rtwdev, s8 ofdm_index,
 	}
 }
 
-static void rtw8723d_pwrtrack_set_ofdm_pwr(struct rtw_dev *rtwdev, s8 swing_idx,
-					   s8 txagc_idx)
+static u8 rtw8723d_pwrtrack_set_ofdm_pwr(struct rtw_dev *rtwdev, s8 swing_idx,
+					 s8 txagc_idx)
 {
 	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+	struct rtw_pwrtrack_info *pt = &dm_info->pwrtrack;
+	u8 apply = 0;
+
+	if (dm_info->txagc_remnant_ofdm != txagc_idx) {
+		dm_info->txagc_remnant_ofdm = txagc_idx;
+		apply |= RTW_PWRTRACK_APPLY_TXAGC;
+	}
 
-	dm_info->txagc_remnant_ofdm = txagc_idx;
+	if (pt->valid && pt->ofdm_swing_idx == swing_idx)
+		return apply;
 
 	rtw8723d_set_iqk_matrix(rtwdev, swing_idx, RF_PATH_A);
 	rtw8723d_set_iqk_matrix(rtwdev, swing_idx, RF_PATH_B);
+	pt->ofdm_swing_idx = swing_idx;
+
+	return apply | RTW_PWRTRACK_APPLY_OFDM;
 }
 
-static void rtw8723d_pwrtrack_set_cck_pwr(struct rtw_dev *rtwdev, s8 swing_idx,
-					  s8 txagc_idx)
+static u8 rtw8723d_pwrtrack_set_cck_pwr(struct rtw_dev *rtwdev, s8 swing_idx,
+					s8 txagc_idx)
 {
 	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+	struct rtw_pwrtrack_info *pt = &dm_info->pwrtrack;
+	u8 apply = 0;
+
+	if (dm_info->txagc_remnant_cck != txagc_idx) {
+		dm_info->txagc_remnant_cck = txagc_idx;
+		apply |= RTW_PWRTRACK_APPLY_TXAGC;
+	}
 
-	dm_info->txagc_remnant_cck = txagc_idx;
+	if (pt->valid && pt->cck_swing_idx == swing_idx)
+		return apply;
 
 	rtw_write32_mask(rtwdev, 0xab4, 0x000007FF,
 			 rtw8723d_cck_swing_table[swing_idx]);
+	pt->cck_swing_idx = swing_idx;
+
+	return apply | RTW_PWRTRACK_APPLY_CCK;
 }
 
-static void rtw8723d_pwrtrack_set(struct rtw_dev *rtwdev, u8 path)
+/* only the swing, remnant and xtal settings that changed are written */
+static u8 rtw8723d_pwrtrack_set(struct rtw_dev *rtwdev, u8 path)
 {
 	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
 	struct rtw_hal *hal = &rtwdev->hal;
@@ -1850,6 +1902,7 @@ static void rtw8723d_pwrtrack_set(struct rtw_dev *rtwdev, u8 path)
 	u8 limit_cck = 40;
 	s8 final_ofdm_swing_index;
 	s8 final_cck_swing_index;
+	u8 apply;
 
 	limit_ofdm = rtw8723d_pwrtrack_get_limit_ofdm(rtwdev);
 
@@ -1859,30 +1912,38 @@ static void rtw8723d_pwrtrack_set(struct rtw_dev *rtwdev, u8 path)
 				dm_info->delta_power_index[path];
 
 	if (final_ofdm_swing_index > limit_ofdm)
-		rtw8723d_pwrtrack_set_ofdm_pwr(rtwdev, limit_ofdm,
-					       final_ofdm_swing_index - limit_ofdm);
+		apply = rtw8723d_pwrtrack_set_ofdm_pwr(rtwdev, limit_ofdm,
+						       final_ofdm_swing_index - limit_ofdm);
 	else if (final_ofdm_swing_index < 0)
-		rtw8723d_pwrtrack_set_ofdm_pwr(rtwdev, 0,
-					       final_ofdm_swing_index);
+		apply = rtw8723d_pwrtrack_set_ofdm_pwr(rtwdev, 0,
+						       final_ofdm_swing_index);
 	else
-		rtw8723d_pwrtrack_set_ofdm_pwr(rtwdev, final_ofdm_swing_index, 0);
+		apply = rtw8723d_pwrtrack_set_ofdm_pwr(rtwdev,
+						       final_ofdm_swing_index, 0);
 
 	if (final_cck_swing_index > limit_cck)
-		rtw8723d_pwrtrack_set_cck_pwr(rtwdev, limit_cck,
-					      final_cck_swing_index - limit_cck);
+		apply |= rtw8723d_pwrtrack_set_cck_pwr(rtwdev, limit_cck,
+						       final_cck_swing_index - limit_cck);
 	else if (final_cck_swing_index < 0)
-		rtw8723d_pwrtrack_set_cck_pwr(rtwdev, 0,
-					      final_cck_swing_index);
+		apply |= rtw8723d_pwrtrack_set_cck_pwr(rtwdev, 0,
+						       final_cck_swing_index);
 	else
-		rtw8723d_pwrtrack_set_cck_pwr(rtwdev, final_cck_swing_index, 0);
+		apply |= rtw8723d_pwrtrack_set_cck_pwr(rtwdev,
+						       final_cck_swing_index, 0);
 
-	rtw_phy_set_tx_power_level(rtwdev, hal->current_channel);
+	if (!dm_info->pwrtrack.valid || apply & RTW_PWRTRACK_APPLY_TXAGC) {
+		rtw_phy_set_tx_power_level(rtwdev, hal->current_channel);
+		apply |= RTW_PWRTRACK_APPLY_TXAGC;
+	}
+
+	return apply;
 }
 
-static void rtw8723d_pwrtrack_set_xtal(struct rtw_dev *rtwdev, u8 therm_path,
-				       u8 delta)
+static u8 rtw8723d_pwrtrack_set_xtal(struct rtw_dev *rtwdev, u8 therm_path,
+				     u8 delta)
 {
 	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+	struct rtw_pwrtrack_info *pt = &dm_info->pwrtrack;
 	const struct rtw_pwr_track_tbl *tbl = rtwdev->chip->pwr_track_tbl;
 	const s8 *pwrtrk_xtal;
 	s8 xtal_cap;
@@ -1895,15 +1956,23 @@ static void rtw8723d_pwrtrack_set_xtal(struct rtw_dev *rtwdev, u8 therm_path,
 
 	xtal_cap = rtwdev->efuse.crystal_cap & 0x3F;
 	xtal_cap = clamp_t(s8, xtal_cap + pwrtrk_xtal[delta], 0, 0x3F);
+	if (pt->valid && pt->xtal_cap == xtal_cap)
+		return 0;
+
 	rtw_write32_mask(rtwdev, REG_AFE_CTRL3, BIT_MASK_XTAL,
 			 xtal_cap | (xtal_cap << 6));
+	pt->xtal_cap = xtal_cap;
+
+	return RTW_PWRTRACK_APPLY_XTAL;
 }
 
 static void rtw8723d_phy_pwrtrack(struct rtw_dev *rtwdev)
 {
 	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+	struct rtw_pwrtrack_info *pt = &dm_info->pwrtrack;
 	struct rtw_swing_table swing_table;
 	u8 thermal_value, delta, path;
+	u8 apply = 0;
 	bool do_iqk = false;
 
 	rtw_phy_config_swing_table(rtwdev, &swing_table);
@@ -1922,7 +1991,8 @@ static void rtw8723d_phy_pwrtrack(struct rtw_dev *rtwdev)
 
 	if (dm_info->pwrtrack_initial_trigger)
 		dm_info->pwrtrack_initial_trigger = false;
-	else if (!rtw_phy_pwrtrack_thermal_changed(rtwdev, thermal_value,
+	else if (pt->valid &&
+		 !rtw_phy_pwrtrack_thermal_changed(rtwdev, thermal_value,
 						   RF_PATH_A))
 		goto iqk;
 
@@ -1934,20 +2004,25 @@ static void rtw8723d_phy_pwrtrack(struct rtw_dev *rtwdev)
 		dm_info->delta_power_index[path] =
 			rtw_phy_pwrtrack_get_pwridx(rtwdev, &swing_table, path,
 						    RF_PATH_A, delta);
-		if (dm_info->delta_power_index[path] ==
-				dm_info->delta_power_index_last[path])
+		if (pt->valid && dm_info->delta_power_index[path] ==
+				 dm_info->delta_power_index_last[path])
 			continue;
 		else
 			dm_info->delta_power_index_last[path] =
 				dm_info->delta_power_index[path];
-		rtw8723d_pwrtrack_set(rtwdev, path);
+		apply |= rtw8723d_pwrtrack_set(rtwdev, path);
 	}
 
-	rtw8723d_pwrtrack_set_xtal(rtwdev, RF_PATH_A, delta);
+	apply |= rtw8723d_pwrtrack_set_xtal(rtwdev, RF_PATH_A, delta);
+	pt->valid = true;
 
 iqk:
-	if (do_iqk)
+	if (do_iqk) {
 		rtw8723d_phy_calibration(rtwdev);
+		apply |= RTW_PWRTRACK_APPLY_IQK;
+	}
+
+	rtw_phy_pwrtrack_trace(rtwdev, apply);
 }
 
 void rtw8723d_pwrtrack_check(struct rtw_dev *rtwdev)
@@ -1958,17 +2033,27 @@ void rtw8723d_pwrtrack_check(struct rtw_dev *rtwdev)
 	if (efuse->power_track_type != 0)
 		return;
 
-	if (!dm_info->pwrtrack_trigger) {
-		rtw_write_rf(rtwdev, RF_PATH_A, RF_T_METER,
-			     GENMASK(17, 16), 0x03);
-		dm_info->pwrtrack_trigger = true;
-		return;
+	if (dm_info->pwrtrack_trigger) {
+		if (!rtw_phy_pwrtrack_sample_due(rtwdev))
+			return;
+
+		rtw8723d_phy_pwrtrack(rtwdev);
+		rtw_phy_pwrtrack_schedule(rtwdev);
 	}
 
-	rtw8723d_phy_pwrtrack(rtwdev);
-	dm_info->pwrtrack_trigger = false;
+	/* keep the meter armed, the next sample reads a fresh conversion */
+	rtw_write_rf(rtwdev, RF_PATH_A, RF_T_METER, GENMASK(17, 16), 0x03);
+	dm_info->pwrtrack_trigger = true;
 }
 
+/* changed by hardware or firmware, or LUT access windows whose content
+ * depends on the selected entry, never served from RF shadow
+ */
+static const u8 rtw8723d_rf_volatile_regs[] = {
+	RF_MODE, RF_WLINT, RF_WLSEL, RF_DTXLOK, RF_CFGCH, RF_RCK, RF_T_METER,
+	RF_LUTWA, RF_LUTWD1, RF_LUTWD0, RF_LUTDBG, RF_LUTWE2, RF_LUTWE,
+};
+
 static struct rtw_chip_ops rtw8723d_ops = {
 	.phy_set_param		= rtw8723d_phy_set_param,
 	.mac_init_system_cfg	= rtw8723d_mac_init_system_cfg,
@@ -2518,6 +2603,8 @@ struct rtw_chip_info rtw8723d_hw_spec = {
 	.rf_sipi_addr = {0x840, 0x844},
 	.rf_sipi_read_addr = rtw8723d_rf_sipi_addr,
 	.rf_phy_nr = 2,
+	.rf_volatile_regs = rtw8723d_rf_volatile_regs,
+	.rf_volatile_num = ARRAY_SIZE(rtw8723d_rf_volatile_regs),
 	.ltecoex_addr = &rtw8723d_ltecoex_addr,
 	.mac_tbl = &rtw8723d_mac_tbl,
 	.agc_tbl = &rtw8723d_agc_tbl,
@@ -120,6 +120,7 @@ static void rtw8822b_pwrtrack_init(struct rtw_dev *rtwdev)
 	dm_info->pwrtrack_trigger = false;
 	dm_info->pwrtrack_initial_trigger = true;
 	dm_info->thermal_meter_k = rtwdev->efuse.thermal_meter_k;
+	rtw_phy_pwrtrack_invalidate(rtwdev);
 }
 
 static void rtw8822b_phy_bf_init(struct rtw_dev *rtwdev)
@@ -708,8 +709,11 @@ static void rtw8822b_set_channel(struct rtw_dev *rtwdev, u8 channel, u8 bw,
 	rfe_info = &rtw8822b_rfe_info[efuse->rfe_option];
 
 	rtw8822b_set_channel_bb(rtwdev, channel, bw, primary_chan_idx);
+	rtw_set_channel_stage(rtwdev, RTW_CHSW_BB);
 	rtw_set_channel_mac(rtwdev, channel, bw, primary_chan_idx);
+	rtw_set_channel_stage(rtwdev, RTW_CHSW_MAC);
 	rtw8822b_set_channel_rf(rtwdev, channel, bw);
+	rtw_set_channel_stage(rtwdev, RTW_CHSW_RF);
 	rtw8822b_set_channel_rxdfir(rtwdev, bw);
 	rtw8822b_toggle_igi(rtwdev);
 	rtw8822b_set_channel_cca(rtwdev, channel, bw, rfe_info);
@@ -964,8 +968,8 @@ rtw8822b_set_tx_power_index_by_rate(struct rtw_dev *rtwdev, u8 path, u8 rs)
 		phy_pwr_idx |= ((u32)pwr_index << (shift * 8));
 		if (shift == 0x3) {
 			rate_idx = rate & 0xfc;
-			rtw_write32(rtwdev, offset_txagc[path] + rate_idx,
-				    phy_pwr_idx);
+			rtw_phy_txagc_add(rtwdev, offset_txagc[path] + rate_idx,
+					  MASKDWORD, phy_pwr_idx);
 			phy_pwr_idx = 0;
 		}
 	}
@@ -976,10 +980,12 @@ static void rtw8822b_set_tx_power_index(struct rtw_dev *rtwdev)
 	struct rtw_hal *hal = &rtwdev->hal;
 	int rs, path;
 
+	rtw_phy_txagc_begin(rtwdev);
 	for (path = 0; path < hal->rf_path_num; path++) {
 		for (rs = 0; rs < RTW_RATE_SECTION_MAX; rs++)
 			rtw8822b_set_tx_power_index_by_rate(rtwdev, path, rs);
 	}
+	rtw_phy_txagc_commit(rtwdev);
 }
 
 static bool rtw8822b_check_rf_path(u8 antenna)
@@ -1438,8 +1444,10 @@ static void rtw8822b_pwrtrack_set(struct rtw_dev *rtwdev, u8 path)
 static void rtw8822b_phy_pwrtrack(struct rtw_dev *rtwdev)
 {
 	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
+	struct rtw_pwrtrack_info *pt = &dm_info->pwrtrack;
 	struct rtw_swing_table swing_table;
 	u8 thermal_value, delta, path;
+	u8 apply = 0;
 
 	rtw_phy_config_swing_table(rtwdev, &swing_table);
 
@@ -1452,7 +1460,8 @@ static void rtw8822b_phy_pwrtrack(struct rtw_dev *rtwdev)
 
 	if (dm_info->pwrtrack_initial_trigger)
 		dm_info->pwrtrack_initial_trigger = false;
-	else if (!rtw_phy_pwrtrack_thermal_changed(rtwdev, thermal_value,
+	else if (pt->valid &&
+		 !rtw_phy_pwrtrack_thermal_changed(rtwdev, thermal_value,
 						   RF_PATH_A))
 		goto iqk;
 
@@ -1464,18 +1473,24 @@ static void rtw8822b_phy_pwrtrack(struct rtw_dev *rtwdev)
 		dm_info->delta_power_index[path] =
 			rtw_phy_pwrtrack_get_pwridx(rtwdev, &swing_table, path,
 						    RF_PATH_A, delta);
-		if (dm_info->delta_power_index[path] ==
-				dm_info->delta_power_index_last[path])
+		if (pt->valid && dm_info->delta_power_index[path] ==
+				 dm_info->delta_power_index_last[path])
 			continue;
 		else
 			dm_info->delta_power_index_last[path] =
 				dm_info->delta_power_index[path];
 		rtw8822b_pwrtrack_set(rtwdev, path);
+		apply |= RTW_PWRTRACK_APPLY_OFDM | RTW_PWRTRACK_APPLY_TXAGC;
 	}
+	pt->valid = true;
 
 iqk:
-	if (rtw_phy_pwrtrack_need_iqk(rtwdev))
+	if (rtw_phy_pwrtrack_need_iqk(rtwdev)) {
 		rtw8822b_do_iqk(rtwdev);
+		apply |= RTW_PWRTRACK_APPLY_IQK;
+	}
+
+	rtw_phy_pwrtrack_trace(rtwdev, apply);
 }
 
 void rtw8822b_pwrtrack_check(struct rtw_dev *rtwdev)
@@ -1486,15 +1501,17 @@ void rtw8822b_pwrtrack_check(struct rtw_dev *rtwdev)
 	if (efuse->power_track_type != 0)
 		return;
 
-	if (!dm_info->pwrtrack_trigger) {
-		rtw_write_rf(rtwdev, RF_PATH_A, RF_T_METER,
-			     GENMASK(17, 16), 0x03);
-		dm_info->pwrtrack_trigger = true;
-		return;
+	if (dm_info->pwrtrack_trigger) {
+		if (!rtw_phy_pwrtrack_sample_due(rtwdev))
+			return;
+
+		rtw8822b_phy_pwrtrack(rtwdev);
+		rtw_phy_pwrtrack_schedule(rtwdev);
 	}
 
-	rtw8822b_phy_pwrtrack(rtwdev);
-	dm_info->pwrtrack_trigger = false;
+	/* keep the meter armed, the next sample reads a fresh conversion */
+	rtw_write_rf(rtwdev, RF_PATH_A, RF_T_METER, GENMASK(17, 16), 0x03);
+	dm_info->pwrtrack_trigger = true;
 }
 
 static void rtw8822b_bf_config_bfee_su(struct rtw_dev *rtwdev,
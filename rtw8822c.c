@@ -481,8 +481,8 @@ static void rtw8822c_dac_cal_step1(struct rtw_dev *rtwdev, u8 path)
 	rtw_write32(rtwdev, base_addr + 0xb8, 0x62000000);
 	rtw_write32(rtwdev, base_addr + 0xd4, 0x62000000);
 	mdelay(20);
-	if (!check_hw_ready(rtwdev, read_addr + 0x08, 0x7fff80, 0xffff) ||
-	    !check_hw_ready(rtwdev, read_addr + 0x34, 0x7fff80, 0xffff))
+	if (rtw_poll32(rtwdev, read_addr + 0x08, 0x7fff80, 0xffff) ||
+	    rtw_poll32(rtwdev, read_addr + 0x34, 0x7fff80, 0xffff))
 		rtw_err(rtwdev, "failed to wait for dack ready\n");
 	rtw_write32(rtwdev, base_addr + 0xb8, 0x02000000);
 	mdelay(1);
@@ -580,8 +580,8 @@ static void rtw8822c_dac_cal_step3(struct rtw_dev *rtwdev, u8 path,
 	rtw_write32(rtwdev, base_addr + 0xb8, 0x62000000);
 	rtw_write32(rtwdev, base_addr + 0xd4, 0x62000000);
 	mdelay(20);
-	if (!check_hw_ready(rtwdev, read_addr + 0x24, 0x07f80000, ic) ||
-	    !check_hw_ready(rtwdev, read_addr + 0x50, 0x07f80000, qc))
+	if (rtw_poll32(rtwdev, read_addr + 0x24, 0x07f80000, ic) ||
+	    rtw_poll32(rtwdev, read_addr + 0x50, 0x07f80000, qc))
 		rtw_err(rtwdev, "failed to write IQ vector to hardware\n");
 	rtw_write32(rtwdev, base_addr + 0xb8, 0x02000000);
 	mdelay(1);
@@ -895,10 +895,10 @@ static bool rtw8822c_dac_cal_restore(struct rtw_dev *rtwdev)
 	temp[2] = rtw_read32(rtwdev, 0x9b4);
 
 	rtw8822c_dac_cal_restore_prepare(rtwdev);
-	if (!check_hw_ready(rtwdev, 0x2808, 0x7fff80, 0xffff) ||
-	    !check_hw_ready(rtwdev, 0x2834, 0x7fff80, 0xffff) ||
-	    !check_hw_ready(rtwdev, 0x4508, 0x7fff80, 0xffff) ||
-	    !check_hw_ready(rtwdev, 0x4534, 0x7fff80, 0xffff))
+	if (rtw_poll32(rtwdev, 0x2808, 0x7fff80, 0xffff) ||
+	    rtw_poll32(rtwdev, 0x2834, 0x7fff80, 0xffff) ||
+	    rtw_poll32(rtwdev, 0x4508, 0x7fff80, 0xffff) ||
+	    rtw_poll32(rtwdev, 0x4534, 0x7fff80, 0xffff))
 		return false;
 
 	if (!__rtw8822c_dac_cal_restore(rtwdev)) {
@@ -1013,12 +1013,14 @@ void rtw8822c_pwrtrack_init(struct rtw_dev *rtwdev)
 
 	for (path = RF_PATH_A; path < RTW_RF_PATH_MAX; path++) {
 		dm_info->delta_power_index[path] = 0;
+		dm_info->delta_power_index_last[path] = 0;
 		ewma_thermal_init(&dm_info->avg_thermal[path]);
 		dm_info->thermal_avg[path] = 0xff;
 	}
 
 	dm_info->pwrtrack_trigger = false;
 	dm_info->thermal_meter_k = rtwdev->efuse.thermal_meter_k;
+	rtw_phy_pwrtrack_invalidate(rtwdev);
 }
 
 static void rtw8822c_phy_set_param(struct rtw_dev *rtwdev)
@@ -1534,8 +1536,11 @@ static void rtw8822c_set_channel(struct rtw_dev *rtwdev, u8 channel, u8 bw,
 				 u8 primary_chan_idx)
 {
 	rtw8822c_set_channel_bb(rtwdev, channel, bw, primary_chan_idx);
+	rtw_set_channel_stage(rtwdev, RTW_CHSW_BB);
 	rtw_set_channel_mac(rtwdev, channel, bw, primary_chan_idx);
+	rtw_set_channel_stage(rtwdev, RTW_CHSW_MAC);
 	rtw8822c_set_channel_rf(rtwdev, channel, bw);
+	rtw_set_channel_stage(rtwdev, RTW_CHSW_RF);
 	rtw8822c_toggle_igi(rtwdev);
 }
 
@@ -2437,7 +2442,7 @@ static u8 rtw8822c_dpk_one_shot(struct rtw_dev *rtwdev, u8 path, u8 action)
 		rtw_write32_mask(rtwdev, REG_DPD_CTL0, BIT(12), 0x0);
 		rtw_write32_mask(rtwdev, REG_RXSRAM_CTL, BIT_RPT_SEL, 0x0);
 		msleep(10);
-		if (!check_hw_ready(rtwdev, REG_STAT_RPT, BIT(31), 0x1)) {
+		if (rtw_poll32(rtwdev, REG_STAT_RPT, BIT(31), 0x1)) {
 			result = 1;
 			rtw_dbg(rtwdev, RTW_DBG_RFK, "[DPK] one-shot over 20ms\n");
 		}
@@ -2450,7 +2455,7 @@ static u8 rtw8822c_dpk_one_shot(struct rtw_dev *rtwdev, u8 path, u8 action)
 		rtw_write32(rtwdev, REG_NCTL0, dpk_cmd);
 		rtw_write32(rtwdev, REG_NCTL0, dpk_cmd + 1);
 		msleep(10);
-		if (!check_hw_ready(rtwdev, 0x2d9c, 0xff, 0x55)) {
+		if (rtw_poll32(rtwdev, 0x2d9c, 0xff, 0x55)) {
 			result = 1;
 			rtw_dbg(rtwdev, RTW_DBG_RFK, "[DPK] one-shot over 20ms\n");
 		}
@@ -2983,7 +2988,7 @@ void rtw8822c_dpk_cal_coef1(struct rtw_dev *rtwdev)
 	rtw_write32(rtwdev, REG_NCTL0, 0x00001148);
 	rtw_write32(rtwdev, REG_NCTL0, 0x00001149);
 
-	check_hw_ready(rtwdev, 0x2d9c, MASKBYTE0, 0x55);
+	rtw_poll32(rtwdev, 0x2d9c, MASKBYTE0, 0x55);
 
 	rtw_write8(rtwdev, 0x1b10, 0x0);
 	rtw_write32_mask(rtwdev, REG_NCTL0, BIT_SUBPAGE, 0x0000000c);
@@ -3338,15 +3343,15 @@ static void rtw8822c_pwrtrack_set(struct rtw_dev *rtwdev, u8 rf_path)
 	}
 }
 
-static void rtw8822c_phy_pwrtrack_path(struct rtw_dev *rtwdev,
-				       struct rtw_swing_table *swing_table,
-				       u8 path)
+static u8 rtw8822c_phy_pwrtrack_path(struct rtw_dev *rtwdev,
+				     struct rtw_swing_table *swing_table,
+				     u8 path)
 {
 	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
 	u8 thermal_value, delta;
 
 	if (rtwdev->efuse.thermal_meter[path] == 0xff)
-		return;
+		return 0;
 
 	thermal_value = rtw_phy_read_rf(rtwdev, path, RF_T_METER, 0x7e);
 
@@ -3361,21 +3366,37 @@ static void rtw8822c_phy_pwrtrack_path(struct rtw_dev *rtwdev,
 		rtw_phy_pwrtrack_get_pwridx(rtwdev, swing_table, path, path,
 					    delta);
 
+	if (dm_info->pwrtrack.valid &&
+	    dm_info->delta_power_index[path] ==
+	    dm_info->delta_power_index_last[path])
+		return 0;
+
+	dm_info->delta_power_index_last[path] =
+		dm_info->delta_power_index[path];
 	rtw8822c_pwrtrack_set(rtwdev, path);
+
+	return RTW_PWRTRACK_APPLY_TXAGC;
 }
 
 static void rtw8822c_phy_pwrtrack(struct rtw_dev *rtwdev)
 {
+	struct rtw_dm_info *dm_info = &rtwdev->dm_info;
 	struct rtw_swing_table swing_table;
+	u8 apply = 0;
 	u8 i;
 
 	rtw_phy_config_swing_table(rtwdev, &swing_table);
 
 	for (i = 0; i < rtwdev->hal.rf_path_num; i++)
-		rtw8822c_phy_pwrtrack_path(rtwdev, &swing_table, i);
+		apply |= rtw8822c_phy_pwrtrack_path(rtwdev, &swing_table, i);
+	dm_info->pwrtrack.valid = true;
 
-	if (rtw_phy_pwrtrack_need_iqk(rtwdev))
+	if (rtw_phy_pwrtrack_need_iqk(rtwdev)) {
 		rtw8822c_do_iqk(rtwdev);
+		apply |= RTW_PWRTRACK_APPLY_IQK;
+	}
+
+	rtw_phy_pwrtrack_trace(rtwdev, apply);
 }
 
 static void rtw8822c_pwrtrack_check(struct rtw_dev *rtwdev)
@@ -3386,21 +3407,24 @@ static void rtw8822c_pwrtrack_check(struct rtw_dev *rtwdev)
 	if (efuse->power_track_type != 0)
 		return;
 
-	if (!dm_info->pwrtrack_trigger) {
-		rtw_write_rf(rtwdev, RF_PATH_A, RF_T_METER, BIT(19), 0x01);
-		rtw_write_rf(rtwdev, RF_PATH_A, RF_T_METER, BIT(19), 0x00);
-		rtw_write_rf(rtwdev, RF_PATH_A, RF_T_METER, BIT(19), 0x01);
-
-		rtw_write_rf(rtwdev, RF_PATH_B, RF_T_METER, BIT(19), 0x01);
-		rtw_write_rf(rtwdev, RF_PATH_B, RF_T_METER, BIT(19), 0x00);
-		rtw_write_rf(rtwdev, RF_PATH_B, RF_T_METER, BIT(19), 0x01);
+	if (dm_info->pwrtrack_trigger) {
+		if (!rtw_phy_pwrtrack_sample_due(rtwdev))
+			return;
 
-		dm_info->pwrtrack_trigger = true;
-		return;
+		rtw8822c_phy_pwrtrack(rtwdev);
+		rtw_phy_pwrtrack_schedule(rtwdev);
 	}
 
-	rtw8822c_phy_pwrtrack(rtwdev);
-	dm_info->pwrtrack_trigger = false;
+	/* keep the meters armed, the next sample reads fresh conversions */
+	rtw_write_rf(rtwdev, RF_PATH_A, RF_T_METER, BIT(19), 0x01);
+	rtw_write_rf(rtwdev, RF_PATH_A, RF_T_METER, BIT(19), 0x00);
+	rtw_write_rf(rtwdev, RF_PATH_A, RF_T_METER, BIT(19), 0x01);
+
+	rtw_write_rf(rtwdev, RF_PATH_B, RF_T_METER, BIT(19), 0x01);
+	rtw_write_rf(rtwdev, RF_PATH_B, RF_T_METER, BIT(19), 0x00);
+	rtw_write_rf(rtwdev, RF_PATH_B, RF_T_METER, BIT(19), 0x01);
+
+	dm_info->pwrtrack_trigger = true;
 }
 
 static struct rtw_pwr_seq_cmd trans_carddis_to_cardemu_8822c[] = {
@@ -12,16 +12,24 @@ void rtw_rx_stats(struct rtw_dev *rtwdev, struct ieee80211_vif *vif,
 {
 	struct ieee80211_hdr *hdr;
 	struct rtw_vif *rtwvif;
+	u8 ac = IEEE80211_AC_BE;
+	u8 tid;
 
 	hdr = (struct ieee80211_hdr *)skb->data;
 
 	if (!ieee80211_is_data(hdr->frame_control))
 		return;
 
+	if (ieee80211_is_data_qos(hdr->frame_control)) {
+		tid = *ieee80211_get_qos_ctl(hdr) & IEEE80211_QOS_CTL_TID_MASK;
+		ac = ieee802_1d_to_ac[tid];
+	}
+
 	if (!is_broadcast_ether_addr(hdr->addr1) &&
 	    !is_multicast_ether_addr(hdr->addr1)) {
 		rtwdev->stats.rx_unicast += skb->len;
 		rtwdev->stats.rx_cnt++;
+		rtw_lps_ctrl_traffic(rtwdev, ac);
 		if (vif) {
 			rtwvif = (struct rtw_vif *)vif->drv_priv;
 			rtwvif->stats.rx_unicast += skb->len;
@@ -31,6 +39,44 @@ void rtw_rx_stats(struct rtw_dev *rtwdev, struct ieee80211_vif *vif,
 }
 EXPORT_SYMBOL(rtw_rx_stats);
 
+void rtw_rx_ring_occupancy(struct rtw_dev *rtwdev, u32 count, u32 ring_len)
+{
+	struct rtw_rx_hist *hist = rtwdev->rx_hist;
+	u32 idx;
+
+	if (!hist || !ring_len)
+		return;
+
+	idx = count * RTW_RX_RING_OCC_NUM / ring_len;
+	if (idx >= RTW_RX_RING_OCC_NUM)
+		idx = RTW_RX_RING_OCC_NUM - 1;
+
+	hist->drain_cnt++;
+	hist->ring_occ[idx]++;
+}
+EXPORT_SYMBOL(rtw_rx_ring_occupancy);
+
+static void rtw_rx_hist_update(struct rtw_dev *rtwdev,
+			       struct rtw_rx_pkt_stat *pkt_stat)
+{
+	struct rtw_rx_hist *hist = rtwdev->rx_hist;
+	struct rtw_rx_rate_stat *stat;
+	/* cam_id carries the MACID field of rx descriptor */
+	u8 mac_id = pkt_stat->cam_id;
+
+	if (!hist || mac_id >= RTW_MAX_MAC_ID_NUM ||
+	    pkt_stat->rate >= DESC_RATE_MAX)
+		return;
+
+	stat = &hist->stat[mac_id][pkt_stat->rate];
+	stat->pkt_cnt++;
+	stat->bytes += pkt_stat->pkt_len;
+	if (pkt_stat->crc_err)
+		stat->crc_err++;
+	if (pkt_stat->icv_err)
+		stat->icv_err++;
+}
+
 struct rtw_rx_addr_match_data {
 	struct rtw_dev *rtwdev;
 	struct ieee80211_hdr *hdr;
@@ -186,5 +232,6 @@ void rtw_rx_fill_rx_status(struct rtw_dev *rtwdev,
 
 	rx_status->signal = pkt_stat->signal_power;
 
+	rtw_rx_hist_update(rtwdev, pkt_stat);
 	rtw_rx_addr_match(rtwdev, pkt_stat, hdr);
 }
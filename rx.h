@@ -43,6 +43,7 @@ enum rx_desc_enc {
 
 void rtw_rx_stats(struct rtw_dev *rtwdev, struct ieee80211_vif *vif,
 		  struct sk_buff *skb);
+void rtw_rx_ring_occupancy(struct rtw_dev *rtwdev, u32 count, u32 ring_len);
 void rtw_rx_fill_rx_status(struct rtw_dev *rtwdev,
 			   struct rtw_rx_pkt_stat *pkt_stat,
 			   struct ieee80211_hdr *hdr,
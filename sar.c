@@ -168,6 +168,8 @@ static void rtw_sar_apply_wrds(struct rtw_dev *rtwdev,
 		rtw_phy_set_tx_power_sar(rtwdev, RTW_REGD_WW, path, 149, 165,
 					 wrds->chain[path].limit[LMT_CH149_165]);
 	}
+
+	rtw_phy_tx_power_cache_invalidate(rtwdev);
 }
 
 static bool rtw_sar_load_static_tables(struct rtw_dev *rtwdev)
@@ -626,6 +628,8 @@ static void rtw_sar_apply_dynamic_tables(struct rtw_dev *rtwdev)
 			rtw_phy_set_tx_power_sar(rtwdev, gm->rd, path, 149, 165, sar);
 		}
 	}
+
+	rtw_phy_tx_power_cache_invalidate(rtwdev);
 }
 
 static bool rtw_sar_check_if_rwsi_changed(struct rtw_dev *rtwdev)
@@ -23,6 +23,7 @@ void rtw_tx_stats(struct rtw_dev *rtwdev, struct ieee80211_vif *vif,
 	    !is_multicast_ether_addr(hdr->addr1)) {
 		rtwdev->stats.tx_unicast += skb->len;
 		rtwdev->stats.tx_cnt++;
+		rtw_lps_ctrl_traffic(rtwdev, skb_get_queue_mapping(skb));
 		if (vif) {
 			rtwvif = (struct rtw_vif *)vif->drv_priv;
 			rtwvif->stats.tx_unicast += skb->len;
@@ -365,11 +366,6 @@ void rtw_tx_pkt_info_update(struct rtw_dev *rtwdev,
 	if (info->flags & IEEE80211_TX_INTFL_MLME_CONN_TX) {
 		info->flags &= ~IEEE80211_TX_CTL_REQ_TX_STATUS;	// no report
 		pkt_info->no_retry = true;	// don't re-tx
-
-		if (rtwdev->need_rfk) {
-			rtwdev->need_rfk = false;
-			chip->ops->phy_calibration(rtwdev);
-		}
 	}
 
 	if (info->flags & IEEE80211_TX_CTL_REQ_TX_STATUS)
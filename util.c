@@ -2,22 +2,99 @@
 /* Copyright(c) 2018-2019  Realtek Corporation
  */
 
+#include <linux/iopoll.h>
 #include "main.h"
 #include "util.h"
 #include "reg.h"
 
-bool check_hw_ready(struct rtw_dev *rtwdev, u32 addr, u32 mask, u32 target)
+#define RTW_POLL_SPIN_US	20
+#define RTW_POLL_SLEEP_US	50
+#define RTW_POLL_TIMEOUT_US	10000
+
+static void rtw_poll_stat_update(struct rtw_dev *rtwdev, unsigned long ip,
+				 ktime_t start, bool timeout)
 {
-	u32 cnt;
+	struct rtw_poll_stats *stats = &rtwdev->poll_stats;
+	struct rtw_poll_stat *stat = NULL;
+	u32 time_us = ktime_us_delta(ktime_get(), start);
+	unsigned long flags;
+	int i;
 
-	for (cnt = 0; cnt < 1000; cnt++) {
-		if (rtw_read32_mask(rtwdev, addr, mask) == target)
-			return true;
+	spin_lock_irqsave(&stats->lock, flags);
 
-		udelay(10);
+	for (i = 0; i < RTW_POLL_STAT_NUM; i++) {
+		if (!stats->stat[i].ip || stats->stat[i].ip == ip) {
+			stat = &stats->stat[i];
+			break;
+		}
 	}
 
-	return false;
+	if (!stat) {
+		stats->overflow_cnt++;
+		goto out;
+	}
+
+	stat->ip = ip;
+	stat->cnt++;
+	if (timeout)
+		stat->timeout_cnt++;
+	stat->max_us = max(stat->max_us, time_us);
+	stat->total_us += time_us;
+
+out:
+	spin_unlock_irqrestore(&stats->lock, flags);
+}
+
+/* busy waits up to 10ms, for the callers in atomic context */
+bool check_hw_ready(struct rtw_dev *rtwdev, u32 addr, u32 mask, u32 target)
+{
+	ktime_t start = ktime_get();
+	u32 val;
+	int ret;
+
+	ret = read_poll_timeout_atomic(rtw_read32_mask, val, val == target,
+				       10, RTW_POLL_TIMEOUT_US, false,
+				       rtwdev, addr, mask);
+	rtw_poll_stat_update(rtwdev, _RET_IP_, start, ret);
+
+	return !ret;
+}
+
+static int __rtw_poll32(struct rtw_dev *rtwdev, u32 addr, u32 mask,
+			u32 target, u32 timeout_us, unsigned long ip)
+{
+	ktime_t start = ktime_get();
+	u32 val;
+	int ret;
+
+	might_sleep();
+
+	/* most of the waits are done in a few us, spin shortly before
+	 * falling back to sleep
+	 */
+	ret = read_poll_timeout_atomic(rtw_read32_mask, val, val == target,
+				       1, RTW_POLL_SPIN_US, false,
+				       rtwdev, addr, mask);
+	if (ret)
+		ret = read_poll_timeout(rtw_read32_mask, val, val == target,
+					RTW_POLL_SLEEP_US, timeout_us, false,
+					rtwdev, addr, mask);
+	rtw_poll_stat_update(rtwdev, ip, start, ret);
+
+	return ret;
+}
+
+/* sleeping wait for (addr & mask) == target, returns -ETIMEDOUT after 10ms */
+int rtw_poll32(struct rtw_dev *rtwdev, u32 addr, u32 mask, u32 target)
+{
+	return __rtw_poll32(rtwdev, addr, mask, target, RTW_POLL_TIMEOUT_US,
+			    _RET_IP_);
+}
+
+int rtw_poll32_timeout(struct rtw_dev *rtwdev, u32 addr, u32 mask, u32 target,
+		       u32 timeout_us)
+{
+	return __rtw_poll32(rtwdev, addr, mask, target, timeout_us, _RET_IP_);
 }
 
 bool ltecoex_read_reg(struct rtw_dev *rtwdev, u16 offset, u32 *val)
@@ -51,30 +128,7 @@ bool ltecoex_reg_write(struct rtw_dev *rtwdev, u16 offset, u32 value)
 void rtw_restore_reg(struct rtw_dev *rtwdev,
 		     struct rtw_backup_info *bckp, u32 num)
 {
-	u8 len;
-	u32 reg;
-	u32 val;
-	int i;
-
-	for (i = 0; i < num; i++, bckp++) {
-		len = bckp->len;
-		reg = bckp->reg;
-		val = bckp->val;
-
-		switch (len) {
-		case 1:
-			rtw_write8(rtwdev, reg, (u8)val);
-			break;
-		case 2:
-			rtw_write16(rtwdev, reg, (u16)val);
-			break;
-		case 4:
-			rtw_write32(rtwdev, reg, (u32)val);
-			break;
-		default:
-			break;
-		}
-	}
+	rtw_write_batch(rtwdev, bckp, num);
 }
 
 void rtw_desc_to_mcsrate(u16 rate, u8 *mcs, u8 *nss)
@@ -9,6 +9,7 @@
 #include "debug.h"
 #include "mac.h"
 #include "ps.h"
+#include "phy.h"
 
 static void rtw_wow_resume_wakeup_reason(struct rtw_dev *rtwdev)
 {
@@ -130,14 +131,14 @@ static void rtw_wow_fw_security_type(struct rtw_dev *rtwdev)
 static void __rtw_wow_pattern_write_cam(struct rtw_dev *rtwdev, u8 addr,
 					u32 wdata)
 {
-	bool ret;
+	int ret;
 
 	rtw_write32(rtwdev, REG_WKFMCAM_RWD, wdata);
 	rtw_write32(rtwdev, REG_WKFMCAM_CMD, BIT_WKFCAM_POLLING_V1 |
 		    BIT_WKFCAM_WE | BIT_WKFCAM_ADDR_V2(addr));
 
-	ret = check_hw_ready(rtwdev, REG_WKFMCAM_CMD, BIT_WKFCAM_POLLING_V1, 0);
-	if (!ret)
+	ret = rtw_poll32(rtwdev, REG_WKFMCAM_CMD, BIT_WKFCAM_POLLING_V1, 0);
+	if (ret)
 		rtw_err(rtwdev, "failed to write pattern cam\n");
 }
 
@@ -313,13 +314,13 @@ static void rtw_wow_pattern_generate(struct rtw_dev *rtwdev,
 
 static void __rtw_wow_pattern_clear_cam(struct rtw_dev *rtwdev)
 {
-	bool ret;
+	int ret;
 
 	rtw_write32(rtwdev, REG_WKFMCAM_CMD, BIT_WKFCAM_POLLING_V1 |
 		    BIT_WKFCAM_CLR_V1);
 
-	ret = check_hw_ready(rtwdev, REG_WKFMCAM_CMD, BIT_WKFCAM_POLLING_V1, 0);
-	if (!ret)
+	ret = rtw_poll32(rtwdev, REG_WKFMCAM_CMD, BIT_WKFCAM_POLLING_V1, 0);
+	if (ret)
 		rtw_err(rtwdev, "failed to clean pattern cam\n");
 }
 
@@ -442,6 +443,13 @@ static int rtw_wow_swap_fw(struct rtw_dev *rtwdev, bool wow)
 
 	rtw_hci_setup(rtwdev);
 
+	/* commands queued for the old firmware must not reach the new one,
+	 * nor the mail box be touched while downloading
+	 */
+	if (!rtw_fw_h2c_queue_flush(rtwdev))
+		rtw_dbg(rtwdev, RTW_DBG_FW, "drop H2C queued before fw swap\n");
+	rtw_fw_h2c_queue_purge(rtwdev);
+
 	ret = rtw_download_firmware(rtwdev, fw);
 	if (ret) {
 		rtw_err(rtwdev, "failed to download %s firmware\n",
@@ -525,6 +533,7 @@ static int rtw_wow_suspend_linked(struct rtw_dev *rtwdev,
 	mutex_lock(&rtwdev->mutex);
 
 	cancel_delayed_work_sync(&rtwdev->watch_dog_work);
+	rtw_phy_dm_engine_stop(rtwdev);
 	cancel_delayed_work_sync(&rtwdev->lps_work);
 	cancel_work_sync(&rtwdev->c2h_work);
 
@@ -536,6 +545,7 @@ static int rtw_wow_suspend_linked(struct rtw_dev *rtwdev,
 	ret = rtw_wow_suspend_start(rtwdev);
 	if (ret) {
 		rtw_wow->suspend_mode = RTW_SUSPEND_IDLE;
+		rtw_phy_dm_engine_start(rtwdev);
 		goto unlock;
 	}
 
@@ -554,6 +564,7 @@ static int rtw_wow_suspend_no_link(struct rtw_dev *rtwdev)
 	mutex_lock(&rtwdev->mutex);
 
 	cancel_delayed_work_sync(&rtwdev->watch_dog_work);
+	rtw_phy_dm_engine_stop(rtwdev);
 	cancel_work_sync(&rtwdev->c2h_work);
 
 	if (test_bit(RTW_FLAG_INACTIVE_PS, rtwdev->flags)) {
@@ -613,6 +624,9 @@ static int rtw_wow_resume_start(struct rtw_dev *rtwdev)
 	rtw_wow->wow_vif = NULL;
 	rtw_wow->suspend_mode = RTW_SUSPEND_IDLE;
 
+	/* the engine bails out while suspend_mode is not idle */
+	rtw_phy_dm_engine_start(rtwdev);
+
 	return ret;
 }
 